@@ -0,0 +1,445 @@
+#include "src/include/gameboard.h"
+#include "src/include/agent.h"
+#include "src/include/bundle.h"
+#include "src/include/bitboard.h"
+#include "src/include/scenario.h"
+#include "src/include/scent.h"
+#include "src/include/horde.h"
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+std::string getLocalDir() { return "./"; }
+
+constexpr int Samples = 7; //Each benchmark's result is the median sample
+constexpr double DefaultThreshold = 10; //% slower than baseline to count as regression
+constexpr unsigned int Seed = 1234; //Fixed so every run plays out the same
+//Horde mode at full strength; has to fit HordeFrameBudgetMs, not just the baseline
+const std::string HordeBench = "horde/" + std::to_string(HordeMonsters);
+
+struct Result {
+  std::string name;
+  long iterations;
+  double nsPerOp;
+};
+
+/* Times iterations of op, repeating Samples times; setup (untimed) runs
+ * before each sample so every sample starts from the same state */
+static Result measure(const std::string &name, long iterations,
+		      std::function<void()> setup, std::function<void()> op)
+{
+  std::vector<double> samples;
+  for(int sample=0; sample<Samples; ++sample) {
+    setup();
+    auto start = std::chrono::steady_clock::now();
+    for(long i=0; i<iterations; ++i) {
+      op();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    samples.push_back(elapsed.count() / iterations);
+  }
+  std::sort(samples.begin(), samples.end());
+  return Result{name, iterations, samples[Samples / 2]};
+}
+
+static Actor makePlayer()
+{
+  Actor player(0, 0, "Player", PlayerTile, true);
+  //Survives every monster for the length of any benchmark
+  player.addHealth(1000000);
+  return player;
+}
+
+/* Exits if a benchmark wasn't set up as meant, rather than timing the wrong thing */
+static void require(bool ok, const char *what)
+{
+  if(!ok) {
+    std::cerr << "Benchmark setup failed: " << what << "\n";
+    std::exit(1);
+  }
+}
+
+/* Headless board on a walled MapWidth x MapHeight map, the player in the
+ * middle and monsters spawned at fixed positions on every other row,
+ * nearest the player first, so they can see and go after them */
+static std::unique_ptr<GameBoard> makeBoard(int monsters)
+{
+  LevelMap map(MapWidth, MapHeight);
+  for(int y=0; y<MapHeight; ++y) {
+    for(int x=0; x<MapWidth; ++x) {
+      if(x == 0 || y == 0 || x == MapWidth - 1 || y == MapHeight - 1) map[y][x] = WallTile;
+    }
+  }
+  const int midX = MapWidth / 2, midY = MapHeight / 2;
+  map[midY][midX] = PlayerTile;
+  std::unique_ptr<GameBoard> board(new GameBoard(nullptr, makePlayer(), map, Seed));
+  require(board->player().getX() == midX && board->player().getY() == midY,
+	  "player not in the middle");
+  std::vector<std::pair<int,int>> cells;
+  for(int y=1; y<MapHeight-1; y+=2) {
+    for(int x=1; x<MapWidth-1; ++x) {
+      cells.push_back({x, y});
+    }
+  }
+  std::stable_sort(cells.begin(), cells.end(),
+		   [midX, midY](const std::pair<int,int> &a, const std::pair<int,int> &b) {
+		     return std::abs(a.first - midX) + std::abs(a.second - midY)
+		       < std::abs(b.first - midX) + std::abs(b.second - midY);
+		   });
+  const char kinds[] = {'I', 'm', 'd', 'B'};
+  int spawned = 0;
+  for(std::size_t i=0; i<cells.size() && spawned<monsters; ++i) {
+    if(board->spawnMonster(kinds[spawned % 4], cells[i].first, cells[i].second)) {
+      ++spawned;
+    }
+  }
+  require(spawned == std::min<int>(monsters, cells.size() - 1), "monsters not spawned");
+  if(monsters > 0) {
+    const Actor &nearest = board->actorAt(1);
+    require(board->isAwake(1) && std::abs(nearest.getX() - midX) + std::abs(nearest.getY() - midY)
+	    <= SightRadius, "nearest monster dormant or out of sight");
+  }
+  return board;
+}
+
+/* Per-char versions of the bitboard queries, to compare against */
+static int countCrowdedChars(const LevelMap &map)
+{
+  int crowded = 0;
+  for(int y=0; y<map.height(); ++y) {
+    for(int x=0; x<map.width(); ++x) {
+      int neighbours = 0;
+      for(int dy=-1; dy<=1; ++dy) {
+	for(int dx=-1; dx<=1; ++dx) {
+	  int nx = x + dx, ny = y + dy;
+	  if((dx != 0 || dy != 0) && nx >= 0 && ny >= 0 && nx < map.width() && ny < map.height()
+	     && map[ny][nx] != 0) {
+	    ++neighbours;
+	  }
+	}
+      }
+      crowded += neighbours >= 5;
+    }
+  }
+  return crowded;
+}
+
+static int floodFillChars(const LevelMap &map, int startX, int startY)
+{
+  std::vector<bool> seen(map.width() * map.height(), false);
+  std::vector<std::pair<int,int>> frontier{{startX, startY}};
+  seen[startY * map.width() + startX] = true;
+  int reached = 0;
+  while(!frontier.empty()) {
+    std::pair<int,int> cell = frontier.back();
+    frontier.pop_back();
+    ++reached;
+    for(int dy=-1; dy<=1; ++dy) {
+      for(int dx=-1; dx<=1; ++dx) {
+	int x = cell.first + dx, y = cell.second + dy;
+	if(x >= 0 && y >= 0 && x < map.width() && y < map.height()
+	   && !seen[y * map.width() + x] && map[y][x] == 0) {
+	  seen[y * map.width() + x] = true;
+	  frontier.push_back({x, y});
+	}
+      }
+    }
+  }
+  return reached;
+}
+
+/* Runs every benchmark; hordeWorstMs is set to the slowest single turn of
+ * the horde benchmark */
+static std::vector<Result> runBenchmarks(double &hordeWorstMs)
+{
+  std::vector<Result> results;
+  std::unique_ptr<GameBoard> board;
+  auto noSetup = [] {};
+
+  //Loading
+  board = makeBoard(0);
+  results.push_back(measure("loadMap", 2000, noSetup,
+			    [&board] { board->loadMap("test-map1.csv"); }));
+  results.push_back(measure("loadMonsterTemplates", 2000, noSetup,
+			    [] { loadMonsterTemplates("src/monsters.ini"); }));
+  results.push_back(measure("loadItemTemplates", 2000, noSetup,
+			    [] { loadItemTemplates("src/items.ini"); }));
+  {
+    //A template file far bigger than the shipped ones
+    const char *path = "bench-templates.ini";
+    {
+      std::ofstream file(path);
+      for(int i=0; i<10000; ++i) {
+	file << "char=" << static_cast<char>('!' + i % 90) << "\nname=Monster " << i
+	     << "\nhealth=" << i % 100 << "\nstrength=" << i % 7 << "\nagility=3\nelite=false\n\n";
+      }
+    }
+    results.push_back(measure("loadMonsterTemplates/10000", 20, noSetup,
+			      [path] { loadMonsterTemplates(path); }));
+    std::remove(path);
+  }
+
+  //Startup: templates (bundled or parsed) through to a board ready to present
+  {
+    const bool hadBundle = std::ifstream(bundlePath("./")).good();
+    std::vector<std::string> errors;
+    writeTemplateBundle("./", errors);
+    results.push_back(measure("loadTemplateSet/bundle", 2000, noSetup,
+			      [] { loadTemplateSet("./"); }));
+    results.push_back(measure("startup/bundle", 500, noSetup, [] {
+	  GameBoard board(nullptr, makePlayer(), "trapped-map.csv", Seed);
+	}));
+    std::remove(bundlePath("./").c_str());
+    results.push_back(measure("loadTemplateSet/ini", 2000, noSetup,
+			      [] { loadTemplateSet("./"); }));
+    results.push_back(measure("startup/ini", 500, noSetup, [] {
+	  GameBoard board(nullptr, makePlayer(), "trapped-map.csv", Seed);
+	}));
+    //Leave the game's bundle as it was found
+    if(hadBundle) {
+      writeTemplateBundle("./", errors);
+    }
+  }
+
+  //Game logic
+  //One updateActors/N op is a whole game turn: every actor updated until
+  //it is the player's turn again
+  for(int monsters : {10, 100, 400}) {
+    results.push_back(measure("updateActors/" + std::to_string(monsters), 200,
+			      [&board, monsters] { board = makeBoard(monsters); },
+			      [&board] {
+				Agent agent(*board);
+				agent.act(Action{ActionType::WAIT, 0, 0});
+			      }));
+  }
+  //A big generated level where most monsters are far from the player and
+  //dormant, so a turn should cost about the same as a small level's
+  for(int entities : {400, 4000}) {
+    LevelMap map;
+    {
+      std::mt19937 generator(Seed);
+      map = generateMap(scenarioOfSize(entities, Seed), generator);
+    }
+    results.push_back(measure("updateActors/sparse/" + std::to_string(entities / 2), 200,
+			      [&board, &map] {
+				board.reset(new GameBoard(nullptr, makePlayer(), map, Seed));
+			      },
+			      [&board] {
+				Agent agent(*board);
+				agent.act(Action{ActionType::WAIT, 0, 0});
+			      }));
+  }
+  {
+    Actor attacker(0, 0, "A", 'A');
+    Actor target(1, 0, "B", 'B');
+    std::mt19937 generator(Seed);
+    results.push_back(measure("Actor::attack", 1000000,
+			      [&generator] { generator.seed(Seed); },
+			      [&attacker, &target, &generator] {
+				attacker.attack(target, generator);
+				//Nobody dies, so every attack is alike
+				attacker.addHealth(15 - attacker.getHealth());
+				target.addHealth(15 - target.getHealth());
+			      }));
+  }
+  results.push_back(measure("Actor::update", 20000,
+			    [&board] {
+			      //A turn first, so the monsters have seen the player
+			      board = makeBoard(50);
+			      Agent(*board).act(Action{ActionType::WAIT, 0, 0});
+			      require(board->perceptionOf(board->actorAt(1)).seesPlayer,
+				      "monster can't see the player");
+			    },
+			    [&board] {
+			      Actor &monster = board->actorAt(1);
+			      monster.setTurn(true);
+			      monster.update(board.get());
+			    }));
+
+  //Whole-map queries on a large generated map, per char vs bit-packed
+  {
+    ScenarioOptions options = scenarioOfSize(0, Seed);
+    options.width = options.height = 256;
+    std::mt19937 generator(Seed);
+    LevelMap map = generateMap(options, generator);
+    for(int y=0; y<map.height(); ++y) {
+      for(int x=0; x<map.width(); ++x) {
+	if(map[y][x] != WallTile) map[y][x] = 0;
+      }
+    }
+    Bitboard walls = Bitboard::fromLayer(map);
+    Bitboard open = walls.inverted();
+    int volatile sink = 0;
+    results.push_back(measure("neighbours/chars/256", 20, noSetup,
+			      [&map, &sink] { sink = countCrowdedChars(map); }));
+    results.push_back(measure("neighbours/bitboard/256", 2000, noSetup,
+			      [&walls, &sink] { sink = walls.neighboursAtLeast(5).count(); }));
+    const int midX = map.width() / 2, midY = map.height() / 2;
+    results.push_back(measure("floodFill/chars/256", 20, noSetup,
+			      [&map, &sink, midX, midY] { sink = floodFillChars(map, midX, midY); }));
+    results.push_back(measure("floodFill/bitboard/256", 20, noSetup,
+			      [&open, &sink, midX, midY] { sink = open.floodFill(midX, midY).count(); }));
+    //Scent that has spread over the whole level, as after a long game
+    ScentMap scent(walls);
+    for(int turn=0; turn<100; ++turn) {
+      scent.emit(midX, midY);
+      scent.spread();
+    }
+    results.push_back(measure("ScentMap::spread/256", 2000, noSetup,
+			      [&scent, midX, midY] { scent.emit(midX, midY); scent.spread(); }));
+    (void)sink;
+  }
+
+  //Horde mode at full strength: from the player's action to presenting the
+  //frame with every monster's moves, as the game loop does. Each turn is
+  //also timed on its own, for the frame budget
+  {
+    Display screen(120, 50);
+    HordeOptions options = hordeOfSize(HordeMonsters, Seed);
+    std::mt19937 generator(Seed);
+    LevelMap arena = generateArena(options, generator);
+    std::unique_ptr<Horde> horde;
+    results.push_back(measure(HordeBench, 10,
+			      [&] {
+				horde.reset();
+				board.reset(new GameBoard(&screen, makePlayer(), arena, Seed));
+				horde.reset(new Horde(*board, options));
+				horde->fill();
+			      },
+			      [&] {
+				auto start = std::chrono::steady_clock::now();
+				Agent(*board).act(Action{ActionType::WAIT, 0, 0});
+				horde->update();
+				board->present();
+				std::chrono::duration<double, std::milli> turn =
+				  std::chrono::steady_clock::now() - start;
+				hordeWorstMs = std::max(hordeWorstMs, turn.count());
+			      }));
+    horde.reset();
+    board.reset();
+  }
+
+  //Drawing (into memory, not the terminal)
+  {
+    Display screen(120, 50);
+    board = makeBoard(100);
+    results.push_back(measure("Display::draw", 20000, noSetup,
+			      [&screen, &board] { screen.draw(board->map(), board->tiles(), board->player()); }));
+    const std::string text(200, 'x');
+    results.push_back(measure("Display::printText", 100000, noSetup,
+			      [&screen, &text] { screen.printText(0, 0, text); }));
+    results.push_back(measure("Display::drawGUI", 100000, noSetup,
+			      [&screen, &board] { screen.drawGUI(board->player()); }));
+  }
+  return results;
+}
+
+static void writeJson(std::ostream &out, const std::vector<Result> &results)
+{
+  out << "{\n  \"benchmarks\": [\n";
+  for(std::size_t i=0; i<results.size(); ++i) {
+    out << "    {\"name\": \"" << results[i].name << "\", \"iterations\": "
+	<< results[i].iterations << ", \"ns_per_op\": " << std::fixed
+	<< std::setprecision(1) << results[i].nsPerOp << "}"
+	<< (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+/* Reads name/ns_per_op pairs back out of a file written by writeJson() */
+static std::vector<Result> readJson(std::istream &in)
+{
+  std::vector<Result> results;
+  std::string line;
+  while(std::getline(in, line)) {
+    auto name = line.find("\"name\": \"");
+    auto ns = line.find("\"ns_per_op\": ");
+    if(name == std::string::npos || ns == std::string::npos) {
+      continue;
+    }
+    name += std::strlen("\"name\": \"");
+    Result result;
+    result.name = line.substr(name, line.find('"', name) - name);
+    result.iterations = 0;
+    result.nsPerOp = std::atof(line.c_str() + ns + std::strlen("\"ns_per_op\": "));
+    results.push_back(result);
+  }
+  return results;
+}
+
+/* Prints each benchmark next to its baseline; returns number of benchmarks
+ * more than threshold percent slower than their baseline */
+static int compare(const std::vector<Result> &results, const std::vector<Result> &baseline,
+		   double threshold)
+{
+  int regressions = 0;
+  for(const Result &result : results) {
+    auto old = std::find_if(baseline.begin(), baseline.end(),
+			    [&result](const Result &each) { return each.name == result.name; });
+    if(old == baseline.end()) {
+      std::cout << std::setw(24) << result.name << "  (not in baseline)\n";
+      continue;
+    }
+    double change = 100 * (result.nsPerOp - old->nsPerOp) / old->nsPerOp;
+    bool regressed = change > threshold;
+    regressions += regressed;
+    std::cout << std::setw(24) << result.name << std::setw(12) << old->nsPerOp << " ->"
+	      << std::setw(12) << result.nsPerOp << " ns  " << std::showpos << change
+	      << std::noshowpos << "%" << (regressed ? "  REGRESSION" : "") << "\n";
+  }
+  return regressions;
+}
+
+/* Usage: bench [--json FILE] [--baseline FILE] [--threshold PERCENT]
+ * Prints ns/op for each benchmark, optionally writing them as JSON and/or
+ * comparing them with a baseline written earlier; exits with 1 if any
+ * benchmark regressed */
+int main(int argc, char *argv[])
+{
+  std::string jsonPath;
+  std::string baselinePath;
+  double threshold = DefaultThreshold;
+  for(int i=1; i+1<argc; i+=2) {
+    if(std::strcmp(argv[i], "--json") == 0) jsonPath = argv[i+1];
+    else if(std::strcmp(argv[i], "--baseline") == 0) baselinePath = argv[i+1];
+    else if(std::strcmp(argv[i], "--threshold") == 0) threshold = std::atof(argv[i+1]);
+  }
+
+  double hordeWorstMs = 0;
+  std::vector<Result> results = runBenchmarks(hordeWorstMs);
+  std::cout << std::fixed << std::setprecision(1);
+  for(const Result &result : results) {
+    std::cout << std::setw(24) << result.name << std::setw(12) << result.nsPerOp << " ns/op\n";
+  }
+  if(!jsonPath.empty()) {
+    std::ofstream json(jsonPath);
+    writeJson(json, results);
+  }
+  //Every turn has to fit the budget, not just a typical one
+  std::cout << std::setw(24) << HordeBench + "/worst" << std::setw(12) << hordeWorstMs
+	    << " ms/turn\n";
+  bool overBudget = hordeWorstMs > HordeFrameBudgetMs;
+  if(overBudget) {
+    std::cout << HordeBench << " went over the " << HordeFrameBudgetMs << " ms frame budget\n";
+  }
+  if(!baselinePath.empty()) {
+    std::ifstream baselineFile(baselinePath);
+    if(!baselineFile) {
+      std::cerr << "Error: could not open baseline " << baselinePath << "\n";
+      return 1;
+    }
+    std::cout << "\nCompared with " << baselinePath << " (threshold " << threshold << "%):\n";
+    int regressions = compare(results, readJson(baselineFile), threshold);
+    std::cout << regressions << " regression(s)\n";
+    return regressions > 0 || overBudget ? 1 : 0;
+  }
+  return overBudget ? 1 : 0;
+}
@@ -1,3 +1,7 @@
 #!/usr/bin/env sh
-#Add debug flag when using static analyzer
-clang++ -std=c++11 -Wall -Wextra -pedantic-errors -o rpg2 src/main.cpp src/libtermbox.a src/display.cpp src/actor.cpp src/item.cpp src/input.cpp src/gameboard.cpp src/template.cpp
+#Add debug flag when using static analyzer; extra flags are passed to the compiler
+#(e.g. ./build.sh -DRPG_TRACE to record a trace of each run to trace.json, or
+#-DRPG_COUNT_ALLOCATIONS to count allocations for the performance overlay).
+#Also compiles the INI templates into src/templates.bin for faster startup
+clang++ -std=c++11 -pthread -Wall -Wextra -pedantic-errors -o rpg2 src/main.cpp src/libtermbox.a src/display.cpp src/actor.cpp src/item.cpp src/input.cpp src/gameboard.cpp src/template.cpp src/zobrist.cpp src/history.cpp src/threadpool.cpp src/lookahead.cpp src/agent.cpp src/batch.cpp src/scenario.cpp src/trace.cpp src/perf.cpp src/mappedfile.cpp src/bundle.cpp src/watcher.cpp src/tiles.cpp src/bitboard.cpp src/regions.cpp src/pathing.cpp src/rays.cpp src/scent.cpp src/horde.cpp src/arena.cpp "$@" \
+    && ./rpg2 --bundle-templates
@@ -0,0 +1,14 @@
+#!/usr/bin/env sh
+#Builds/runs benchmark suite, writing results as JSON to bench_output.txt
+#  ./run-bench.sh --save     also stores results as the baseline (bench-baseline.json)
+#  ./run-bench.sh --compare  also compares results with the baseline; fails on regression
+g++ -std=c++11 -pthread -O2 -o bench bench-suite.cpp src/libtermbox.a src/display.cpp src/actor.cpp src/item.cpp src/input.cpp src/gameboard.cpp src/template.cpp src/zobrist.cpp src/history.cpp src/threadpool.cpp src/lookahead.cpp src/agent.cpp src/batch.cpp src/scenario.cpp src/trace.cpp src/perf.cpp src/mappedfile.cpp src/bundle.cpp src/watcher.cpp src/tiles.cpp src/bitboard.cpp src/regions.cpp src/pathing.cpp src/rays.cpp src/scent.cpp src/horde.cpp src/arena.cpp
+case "$1" in
+    --compare) ./bench --json bench_output.txt --baseline bench-baseline.json; status=$? ;;
+    *) ./bench --json bench_output.txt; status=$? ;;
+esac
+if [ "$1" = "--save" ] && [ $status -eq 0 ]; then
+    cp bench_output.txt bench-baseline.json
+fi
+rm bench
+exit $status
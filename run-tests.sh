@@ -1,4 +1,4 @@
 #!/usr/bin/env sh
-g++ -std=c++11 -o test test-suite.cpp src/libtermbox.a src/display.cpp src/actor.cpp src/item.cpp src/input.cpp src/gameboard.cpp src/template.cpp
+g++ -std=c++11 -pthread -o test test-suite.cpp src/libtermbox.a src/display.cpp src/actor.cpp src/item.cpp src/input.cpp src/gameboard.cpp src/template.cpp src/zobrist.cpp src/history.cpp src/threadpool.cpp src/lookahead.cpp src/agent.cpp src/batch.cpp src/scenario.cpp src/trace.cpp src/perf.cpp src/mappedfile.cpp src/bundle.cpp src/watcher.cpp src/tiles.cpp src/bitboard.cpp src/regions.cpp src/pathing.cpp src/rays.cpp src/scent.cpp src/horde.cpp src/arena.cpp
 ./test
 rm test
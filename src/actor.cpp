@@ -1,21 +1,18 @@
 #include "include/actor.h"
 #include "include/gameboard.h"
-#include <random>
-#include <ctime>
 
-//RNG
+//RNG; rolls always use the caller's generator (in a game, the GameBoard's)
 /* Gets random integer on range [min, max]*/
-static int getRandomNumber(int min, int max)
+static int getRandomNumber(int min, int max, std::mt19937 &generator)
 {
-    static std::mt19937 generator(static_cast<unsigned int>(std::time(nullptr)));
     std::uniform_int_distribution<int> distribution(min, max);
     return distribution(generator);
 }
 
 /* Given a skill amount for 2 actors, decide using RNG/relative skills who wins skill check */
-bool actorWins(int skillAmt, int otherSkillAmt)
+bool actorWins(int skillAmt, int otherSkillAmt, std::mt19937 &generator)
 {
-    int randNumber = getRandomNumber(0, RNGUpperLimit);
+    int randNumber = getRandomNumber(0, RNGUpperLimit, generator);
     int difference = skillAmt - otherSkillAmt;
     int divider = RNGUpperLimit / 2;
     if(difference != 0) {
@@ -27,7 +24,7 @@ bool actorWins(int skillAmt, int otherSkillAmt)
 
 /* Given a skill amount and an array of armor worn, determines the total bonus
  * of the armor worn based on type, accounting for each piece being worn */
-int getArmorBonus(int skillAmt, Item *armor)
+int getArmorBonus(int skillAmt, const Item *armor)
 {
     int armorBonus = 0;
     for(int i=0; i<ARMOR_MAX; ++i) {
@@ -43,20 +40,42 @@ int getArmorBonus(int skillAmt, Item *armor)
 
 /* Given skill amounts/armor arrays for 2 actors, determine who wins the fight
  * using RNG based on their armor and the given skill amounts*/
-bool actorWinsFight(int skillAmt, int otherSkillAmt, Item *armor, Item *otherArmor)
+bool actorWinsFight(int skillAmt, int otherSkillAmt, const Item *armor,
+		    const Item *otherArmor, std::mt19937 &generator)
 {
     int armorBonus = getArmorBonus(skillAmt, armor);
     int otherArmorBonus = getArmorBonus(otherSkillAmt, otherArmor);
-    return actorWins(skillAmt + armorBonus, otherSkillAmt + otherArmorBonus);
+    return actorWins(skillAmt + armorBonus, otherSkillAmt + otherArmorBonus, generator);
 }
 
-int findDamage(int armorBonus, int attackerWeaponBonus)
+static int findDamage(int armorBonus, int attackerWeaponBonus, std::mt19937 &generator)
 {
     if(armorBonus > attackerWeaponBonus) {
-	return getRandomNumber(0, attackerWeaponBonus / 2);
+	return getRandomNumber(0, attackerWeaponBonus / 2, generator);
     }
     else {
-	return getRandomNumber(0, attackerWeaponBonus + attackerWeaponBonus - armorBonus);
+	return getRandomNumber(0, attackerWeaponBonus + attackerWeaponBonus - armorBonus,
+			       generator);
+    }
+}
+
+/* Decides who wins a melee exchange and how much damage the loser takes;
+   returns true if the attacker won. Used for real fights and simulated ones*/
+bool resolveAttack(const CombatStats &attacker, const CombatStats &target,
+		   int &damage, std::mt19937 &generator)
+{
+    damage = 1;
+    if(actorWins(attacker.strength + attacker.armorBonus,
+		 target.strength + target.armorBonus, generator)) {
+	if(attacker.meleeAttack >= 0) {
+	    damage = findDamage(target.armorBonus, attacker.meleeAttack, generator);
+	}
+	return true;
+    } else {
+	if(target.meleeAttack >= 0) {
+	    damage = findDamage(attacker.armorBonus, target.meleeAttack, generator);
+	}
+	return false;
     }
 }
 
@@ -107,32 +126,32 @@ void Actor::move(int newX, int newY)
     --m_energy;
 }
 
-/* Attempts to attack another Actor*/
-bool Actor::attack(Actor &target)
+/* Attempts to attack another Actor, rolling with the given generator*/
+bool Actor::attack(Actor &target, std::mt19937 &generator)
 {
     --m_energy;
-    if(actorWinsFight(m_strength, target.m_strength, m_equipment, target.m_equipment)) {
-	Item *weapon = getEquipped(MELEE_WEAPON);
-	int damage = 1;
-	if(weapon != nullptr && weapon->isMelee()) {
-	    damage = findDamage(getArmorBonus(target.m_strength, target.m_equipment),
-				weapon->getAttack());
-	}
+    int damage = 0;
+    if(resolveAttack(combatStats(), target.combatStats(), damage, generator)) {
 	target.addHealth(-damage);
 	m_levelProgress += damage;
 	return true;
     } else {
-	Item *weapon = target.getEquipped(MELEE_WEAPON);
-	int damage = 1;
-	if(weapon != nullptr && weapon->isMelee()) {
-	    damage = findDamage(getArmorBonus(m_strength, m_equipment),
-				weapon->getAttack());
-	}
 	addHealth(-damage);
 	return false;
     }
 }
 
+/* Gets the skill/armor/weapon values that decide this Actor's fights*/
+CombatStats Actor::combatStats() const
+{
+    const Item *weapon = getEquipped(MELEE_WEAPON);
+    int meleeAttack = -1;
+    if(weapon != nullptr && weapon->isMelee()) {
+	meleeAttack = weapon->getAttack();
+    }
+    return CombatStats{m_strength, getArmorBonus(m_strength, m_equipment), meleeAttack};
+}
+
 /* Called once every tick; serves as location for AI, visual
    effects, or anything else that needs to happen regularly*/
 void Actor::update(GameBoard *board)
@@ -145,36 +164,37 @@ void Actor::update(GameBoard *board)
 
     //Monster AI
     if(m_isTurn && !m_isPlayer) {
-	int playerX = board->player().getX();
-	int playerY = board->player().getY();
-	int move[2] = { 0, 0 };
-	bool moved = false;
-	//Try to move towards the player
-	if(m_xPos - playerX > 0) move[0] = -1;
-	else if(m_xPos - playerX < 0) move[0] = 1;
+	board->commitPlan(*this, plan(*board));
+    }
+}
 
-	if(m_yPos - playerY > 0) move[1] = -1;
-	else if(m_yPos - playerY < 0) move[1] = 1;
+/* Decides a monster's next step from what it perceives of the player. It
+   only reads the board, so every monster can plan at once; the board
+   carries the plans out one at a time (see GameBoard::commitPlan())*/
+MovePlan Actor::plan(const GameBoard &board) const
+{
+    MovePlan next{false, false, 0, 0};
+    const Actor *target = board.targetFor(*this);
+    const Perception seen = board.perceptionOf(*this);
+    if(target || seen.lastSeen >= 0) {
+	//Elites near the player search for their best move instead
+	next.lookahead = target && m_isElite;
+	//Try to move towards the target, or where it was last seen
+	int goalX = target ? target->getX() : seen.lastX;
+	int goalY = target ? target->getY() : seen.lastY;
+	if(m_xPos - goalX > 0) next.dx = -1;
+	else if(m_xPos - goalX < 0) next.dx = 1;
 
-	moved = board->translateActor(*this, move[0], move[1]);
-	if(moved) {
-	    return;
-	}
-	//Attempt 2
-	int priorX = move[0];
-	move[0] = 0;
-	moved = board->translateActor(*this, move[0], move[1]);
-	if(moved) {
-	    return;
-	}
-	//Attempt 3
-	move[0] = priorX;
-	move[1] = 0;
-	moved = board->translateActor(*this, move[0], move[1]);
-	if(!moved) {
-	    m_isTurn = false;
-	}
+	if(m_yPos - goalY > 0) next.dy = -1;
+	else if(m_yPos - goalY < 0) next.dy = 1;
+	//Got there and they're gone, with no scent to follow
+	next.wait = next.dx == 0 && next.dy == 0
+	    && !board.scent().strongestNeighbour(m_xPos, m_yPos, next.dx, next.dy);
+    } else {
+	//Nobody in sight and no scent to follow, so wait
+	next.wait = !board.scent().strongestNeighbour(m_xPos, m_yPos, next.dx, next.dy);
     }
+    return next;
 }
 
 /* Changes if turn/not, how much energy for the turn*/
@@ -184,6 +204,25 @@ void Actor::setTurn(bool isTurn, int energy)
     m_energy = energy;
 }
 
+/* Takes on the name/stats/skills of a (reloaded) template, keeping this
+   Actor's position, health, energy, and inventory*/
+void Actor::applyTemplate(const Actor &temp)
+{
+    m_name = temp.m_name;
+    m_isElite = temp.m_isElite;
+    m_maxCarryWeight = temp.m_maxCarryWeight;
+    m_level = temp.m_level;
+    m_strength = temp.m_strength;
+    m_cunning = temp.m_cunning;
+    m_agility = temp.m_agility;
+    m_education = temp.m_education;
+    m_sidearmSkill = temp.m_sidearmSkill;
+    m_longarmSkill = temp.m_longarmSkill;
+    m_meleeSkill = temp.m_meleeSkill;
+    m_barterSkill = temp.m_barterSkill;
+    m_negotiateSkill = temp.m_negotiateSkill;
+}
+
 /* Checks if actor has enough inventory space left to carry an item of given weight */
 bool Actor::canCarry(int itemWeight) const
 {
@@ -193,12 +232,20 @@ bool Actor::canCarry(int itemWeight) const
 /* Gives pointer to item in inventory*/
 Item* Actor::getItemAt(int index)
 {
-    using vector_t = std::vector<Item>::size_type;
+    using vector_t = ItemList::size_type;
     if(static_cast<vector_t>(index) >= m_inventory.size())
 	return nullptr;
     return &m_inventory[index];
 }
 
+/* Moves the inventory into memory from the given allocator (e.g. the
+   level's Arena, once this Actor's on it)*/
+void Actor::useAllocator(const ArenaAllocator<Item> &allocator)
+{
+    ItemList inventory(m_inventory.begin(), m_inventory.end(), allocator);
+    m_inventory = std::move(inventory);
+}
+
 /* Adds a new Item to inventory*/
 void Actor::addItem(Item &item)
 {
@@ -224,7 +271,7 @@ void Actor::deleteItem(Item &item)
 /* Places inventory item into equip slot; checks if valid*/
 void Actor::equipItem(int index, int position)
 {
-    using index_t = std::vector<Item>::size_type;
+    using index_t = ItemList::size_type;
     if(index < 0 || static_cast<index_t>(index) >= m_inventory.size()
        || position >= EQUIP_MAX || position < 0) {
 	return;
@@ -262,6 +309,14 @@ Item* Actor::getEquipped(int index)
     return &m_equipment[index];
 }
 
+const Item* Actor::getEquipped(int index) const
+{
+    if(index < 0 || index >= EQUIP_MAX || !m_equipment[index].isEquipped()) {
+	return nullptr;
+    }
+    return &m_equipment[index];
+}
+
 /* Changes health points of Actor*/
 void Actor::addHealth(int amount)
 {
@@ -0,0 +1,191 @@
+#include "include/agent.h"
+#include "include/lookahead.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+/* Drives the given board; elites on it search a fixed number of rollouts
+   rather than for a fixed time, so games replay the same on any machine*/
+Agent::Agent(GameBoard &board)
+    : m_board(board)
+{
+    board.setLookaheadRollouts(LookaheadRollouts);
+}
+
+/* Describes what the player can see of the area around them (cells out
+   of sight are blanked), the other Actors in sight, the player's items,
+   and messages logged since the last observation*/
+Observation Agent::observe()
+{
+    Actor &player = m_board.player();
+    Observation observation;
+    observation.turn = m_board.turn();
+    observation.hash = m_board.hash();
+    observation.alive = player.isAlive();
+    observation.x = player.getX();
+    observation.y = player.getY();
+    observation.health = player.getHealth();
+    observation.energy = player.getEnergy();
+
+    observation.viewX = std::max(0, player.getX() - AgentViewRadius);
+    observation.viewY = std::max(0, player.getY() - AgentViewRadius);
+    const LayeredMap &map = m_board.map();
+    int endX = std::min(map.width(), player.getX() + AgentViewRadius + 1);
+    int endY = std::min(map.height(), player.getY() + AgentViewRadius + 1);
+    for(int y=observation.viewY; y<endY; ++y) {
+	std::string row;
+	for(int x=observation.viewX; x<endX; ++x) {
+	    row += m_board.canSee(x, y) ? m_board.tiles()[map.top(x, y)].glyph : UnseenGlyph;
+	}
+	observation.tiles.push_back(row);
+    }
+    for(const Actor &actor : m_board.actors()) {
+	if(&actor == &player || !actor.isAlive()
+	   || actor.getX() < observation.viewX || actor.getX() >= endX
+	   || actor.getY() < observation.viewY || actor.getY() >= endY
+	   || !m_board.canSee(actor.getX(), actor.getY())) {
+	    continue;
+	}
+	observation.actors.push_back(ActorView{actor.getCh(), actor.getName(),
+		    actor.getX(), actor.getY(), actor.getHealth()});
+    }
+
+    for(int i=0; i<player.getInventorySize(); ++i) {
+	observation.inventory.push_back(player.getItemAt(i)->getName());
+    }
+    for(int i=0; i<EQUIP_MAX; ++i) {
+	Item *item = player.getEquipped(i);
+	observation.equipped.push_back(item != nullptr ? item->getName() : "");
+    }
+    observation.log = m_board.takeMessages();
+    return observation;
+}
+
+/* Carries out one player action; once the player is out of energy, lets
+   every monster take its turn. Returns false if the action was invalid*/
+bool Agent::act(const Action &action)
+{
+    if(isOver()) {
+	return false;
+    }
+    Actor &player = m_board.player();
+    //Coordinates come from outside; ones off the map are turned down here
+    if((action.type == ActionType::TELEPORT || action.type == ActionType::RANGE_ATTACK)
+       && (action.a < 0 || action.a >= m_board.map().width()
+	   || action.b < 0 || action.b >= m_board.map().height())) {
+	return false;
+    }
+    bool succeeded = false;
+    switch(action.type) {
+    case ActionType::MOVE:
+	succeeded = m_board.translateActor(player, action.a, action.b);
+	break;
+    case ActionType::TELEPORT:
+	succeeded = m_board.moveActor(player, action.a, action.b);
+	break;
+    case ActionType::RANGE_ATTACK:
+	succeeded = m_board.rangeAttack(player, action.a, action.b);
+	break;
+    case ActionType::EQUIP:
+	succeeded = m_board.equipItem(player, action.a, action.b);
+	break;
+    case ActionType::DEEQUIP:
+	succeeded = m_board.deequipItem(player, action.a);
+	break;
+    case ActionType::WAIT:
+	m_board.endTurn(player);
+	succeeded = true;
+	break;
+    }
+    m_board.finishPlayerTurn();
+    return succeeded;
+}
+
+/* Reads an action in the line protocol's format (e.g. "move -1 0");
+   returns false if the line isn't a valid action*/
+bool parseAction(const std::string &line, Action &action)
+{
+    std::istringstream words(line);
+    std::string command;
+    words >> command;
+    action.a = 0;
+    action.b = 0;
+    int arguments = 2;
+    if(command == "move") action.type = ActionType::MOVE;
+    else if(command == "teleport") action.type = ActionType::TELEPORT;
+    else if(command == "range") action.type = ActionType::RANGE_ATTACK;
+    else if(command == "equip") action.type = ActionType::EQUIP;
+    else if(command == "deequip") {
+	action.type = ActionType::DEEQUIP;
+	arguments = 1;
+    } else if(command == "wait") {
+	action.type = ActionType::WAIT;
+	arguments = 0;
+    } else {
+	return false;
+    }
+    if(arguments >= 1 && !(words >> action.a)) return false;
+    if(arguments >= 2 && !(words >> action.b)) return false;
+    return true;
+}
+
+/* Writes an observation as lines of text, ending with "end"*/
+void writeObservation(std::ostream &out, const Observation &observation)
+{
+    out << "turn " << observation.turn << " hash " << std::hex << observation.hash
+	<< std::dec << " alive " << observation.alive << "\n";
+    out << "player " << observation.x << " " << observation.y << " health "
+	<< observation.health << " energy " << observation.energy << "\n";
+    out << "view " << observation.viewX << " " << observation.viewY << " "
+	<< observation.tiles.size() << "\n";
+    for(const std::string &row : observation.tiles) {
+	out << row << "\n";
+    }
+    out << "actors " << observation.actors.size() << "\n";
+    for(const ActorView &actor : observation.actors) {
+	out << actor.ch << " " << actor.x << " " << actor.y << " " << actor.health
+	    << " " << actor.name << "\n";
+    }
+    out << "inventory " << observation.inventory.size() << "\n";
+    for(const std::string &name : observation.inventory) {
+	out << name << "\n";
+    }
+    out << "equipped " << observation.equipped.size() << "\n";
+    for(const std::string &name : observation.equipped) {
+	out << (name.empty() ? "-" : name) << "\n";
+    }
+    out << "log " << observation.log.size() << "\n";
+    for(const std::string &message : observation.log) {
+	out << message << "\n";
+    }
+    out << "end\n";
+}
+
+/* Plays the game over a line protocol: each line read is a command
+   ("observe", "quit", or an action, see parseAction()); each action is
+   answered with "ok"/"fail" and then the new observation*/
+void runAgentProtocol(GameBoard &board, std::istream &in, std::ostream &out)
+{
+    Agent agent(board);
+    std::string line;
+    while(std::getline(in, line)) {
+	if(line.empty()) {
+	    continue;
+	} else if(line == "quit") {
+	    break;
+	} else if(line == "observe") {
+	    writeObservation(out, agent.observe());
+	    out.flush();
+	    continue;
+	}
+	Action action;
+	if(!parseAction(line, action)) {
+	    out << "error unknown command: " << line << "\n";
+	    out.flush();
+	    continue;
+	}
+	out << (agent.act(action) ? "ok" : "fail") << "\n";
+	writeObservation(out, agent.observe());
+	out.flush();
+    }
+}
@@ -0,0 +1,65 @@
+#include "include/arena.h"
+#include <cstdint>
+
+Arena::Arena() : m_next(nullptr), m_end(nullptr), m_used(0)
+{
+}
+
+/* Starts a new block big enough for atLeast bytes (at any alignment)*/
+void Arena::addBlock(std::size_t atLeast)
+{
+    std::size_t size = atLeast + alignof(std::max_align_t);
+    if(size < ArenaBlockSize) {
+	size = ArenaBlockSize;
+    }
+    m_blocks.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+    m_next = m_blocks.back().memory.get();
+    m_end = m_next + size;
+}
+
+/* Hands out bytes at the given alignment (a power of 2), starting a new
+   block if the newest one is too full*/
+void* Arena::allocate(std::size_t bytes, std::size_t alignment)
+{
+    std::uintptr_t at = reinterpret_cast<std::uintptr_t>(m_next);
+    std::size_t padding = (alignment - at % alignment) % alignment;
+    if(!m_next || padding + bytes > static_cast<std::size_t>(m_end - m_next)) {
+	addBlock(bytes + alignment);
+	at = reinterpret_cast<std::uintptr_t>(m_next);
+	padding = (alignment - at % alignment) % alignment;
+    }
+    char *memory = m_next + padding;
+    m_next = memory + bytes;
+    m_used += bytes;
+    return memory;
+}
+
+/* Releases everything handed out, keeping the first block to start over
+   in; whatever was in the Arena must have been destroyed (or never need
+   it) first*/
+void Arena::reset()
+{
+    if(m_blocks.size() > 1) {
+	m_blocks.erase(m_blocks.begin() + 1, m_blocks.end());
+    }
+    if(m_blocks.empty()) {
+	m_next = m_end = nullptr;
+    } else {
+	m_next = m_blocks[0].memory.get();
+	m_end = m_next + m_blocks[0].size;
+    }
+    m_used = 0;
+}
+
+/* Whether the given memory came from this Arena (and hasn't been reset)*/
+bool Arena::owns(const void *memory) const
+{
+    const char *at = static_cast<const char*>(memory);
+    for(const Block &block : m_blocks) {
+	const char *begin = block.memory.get();
+	if(at >= begin && at < begin + block.size) {
+	    return &block != &m_blocks.back() || at < m_next;
+	}
+    }
+    return false;
+}
@@ -0,0 +1,125 @@
+#include "include/batch.h"
+#include "include/agent.h"
+#include "include/trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+/* Bot used for automated games: steps toward the nearest visible monster
+   (attacking it once adjacent), otherwise wanders*/
+static Action chooseAction(const Observation &observation, std::mt19937 &generator)
+{
+    const ActorView *nearest = nullptr;
+    int nearestDistance = 0;
+    for(const ActorView &actor : observation.actors) {
+	int distance = std::max(std::abs(actor.x - observation.x),
+				std::abs(actor.y - observation.y));
+	if(nearest == nullptr || distance < nearestDistance) {
+	    nearest = &actor;
+	    nearestDistance = distance;
+	}
+    }
+    if(nearest != nullptr) {
+	return Action{ActionType::MOVE, (nearest->x > observation.x) - (nearest->x < observation.x),
+		(nearest->y > observation.y) - (nearest->y < observation.y)};
+    }
+    std::uniform_int_distribution<int> step(-1, 1);
+    return Action{ActionType::MOVE, step(generator), step(generator)};
+}
+
+/* Plays one headless game with the bot until the player wins, dies, or
+   runs out of turns*/
+GameResult playGame(const BatchOptions &options, unsigned int seed)
+{
+    TRACE_SCOPE("playGame");
+    GameBoard board(nullptr, Actor(0, 0, "Player", PlayerTile, true), options.mapPath, seed);
+    //Batch already keeps every core busy with games
+    board.setSearchThreads(0);
+    Agent agent(board);
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> step(-1, 1);
+    const int monsters = board.actors().size() - 1;
+
+    while(!agent.isOver() && board.turn() < options.maxTurns && board.actors().size() > 1) {
+	Observation observation = agent.observe();
+	if(agent.act(chooseAction(observation, generator))) {
+	    continue;
+	}
+	//Blocked; try a random direction, or give up the turn
+	if(!agent.act(Action{ActionType::MOVE, step(generator), step(generator)})) {
+	    agent.act(Action{ActionType::WAIT, 0, 0});
+	}
+    }
+
+    GameResult result;
+    result.died = agent.isOver();
+    result.won = !result.died && board.actors().size() == 1;
+    result.turns = board.turn();
+    result.kills = monsters - (board.actors().size() - 1);
+    result.health = board.player().getHealth();
+    return result;
+}
+
+/* Plays options.games games spread over a work-stealing pool, each with its
+   own board and seed, and totals up how they went*/
+BatchReport runBatch(const BatchOptions &options)
+{
+    std::vector<GameResult> results(options.games);
+    auto start = std::chrono::steady_clock::now();
+    {
+	ThreadPool pool(options.threads);
+	for(int i=0; i<options.games; ++i) {
+	    GameResult &result = results[i];
+	    pool.submit([&options, &result, i] {
+		result = playGame(options, options.seed + i);
+	    });
+	}
+	pool.wait();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    BatchReport report{options.games, options.threads, 0, 0, 0, 0, 0, 0, 0, 0,
+		       elapsed.count()};
+    for(std::size_t i=0; i<results.size(); ++i) {
+	const GameResult &result = results[i];
+	if(result.won) ++report.wins;
+	else if(result.died) ++report.deaths;
+	else ++report.timeouts;
+	if(!result.died) report.survivorHealth += result.health;
+	report.totalTurns += result.turns;
+	report.totalKills += result.kills;
+	if(i == 0 || result.turns < report.minTurns) report.minTurns = result.turns;
+	if(i == 0 || result.turns > report.maxTurns) report.maxTurns = result.turns;
+    }
+    return report;
+}
+
+static double percent(long part, long whole)
+{
+    return whole == 0 ? 0 : 100.0 * part / whole;
+}
+
+static double average(long total, long count)
+{
+    return count == 0 ? 0 : static_cast<double>(total) / count;
+}
+
+void writeReport(std::ostream &out, const BatchReport &report)
+{
+    out << std::fixed << std::setprecision(1);
+    out << report.games << " games in " << report.seconds << "s on " << report.threads
+	<< " threads: " << report.games / report.seconds << " games/sec, "
+	<< report.totalTurns / report.seconds << " turns/sec\n";
+    out << "Wins: " << report.wins << " (" << percent(report.wins, report.games) << "%)"
+	<< ", deaths: " << report.deaths << " (" << percent(report.deaths, report.games) << "%)"
+	<< ", timeouts: " << report.timeouts
+	<< " (" << percent(report.timeouts, report.games) << "%)\n";
+    out << "Turns per game: mean " << average(report.totalTurns, report.games)
+	<< ", min " << report.minTurns << ", max " << report.maxTurns << "\n";
+    out << "Kills per game: mean " << average(report.totalKills, report.games)
+	<< "; health left when surviving: mean "
+	<< average(report.survivorHealth, report.games - report.deaths) << "\n";
+}
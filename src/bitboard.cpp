@@ -0,0 +1,299 @@
+#include "include/bitboard.h"
+#include "include/rays.h"
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+static int popCount(std::uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    word = word - ((word >> 1) & 0x5555555555555555ULL);
+    word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+    word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<int>((word * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+Bitboard::Bitboard(int width, int height)
+    : m_width(width), m_height(height),
+      m_rowWords((width + BitsPerWord - 1) / BitsPerWord),
+      m_bits(m_rowWords * height, 0)
+{
+}
+
+/* Zeroes the bits past the map's width in each row's last word*/
+void Bitboard::clearPadding()
+{
+    int used = m_width % BitsPerWord;
+    if(used == 0) {
+	return;
+    }
+    std::uint64_t mask = (std::uint64_t(1) << used) - 1;
+    for(int y=0; y<m_height; ++y) {
+	row(y)[m_rowWords - 1] &= mask;
+    }
+}
+
+void Bitboard::clear()
+{
+    std::fill(m_bits.begin(), m_bits.end(), 0);
+}
+
+bool Bitboard::any() const
+{
+    for(std::uint64_t word : m_bits) {
+	if(word != 0) return true;
+    }
+    return false;
+}
+
+int Bitboard::count() const
+{
+    int total = 0;
+    for(std::uint64_t word : m_bits) {
+	total += popCount(word);
+    }
+    return total;
+}
+
+Bitboard& Bitboard::operator|=(const Bitboard &other)
+{
+    for(std::size_t i=0; i<m_bits.size(); ++i) {
+	m_bits[i] |= other.m_bits[i];
+    }
+    return *this;
+}
+
+Bitboard& Bitboard::operator&=(const Bitboard &other)
+{
+    for(std::size_t i=0; i<m_bits.size(); ++i) {
+	m_bits[i] &= other.m_bits[i];
+    }
+    return *this;
+}
+
+/* Clears every cell set in other*/
+Bitboard& Bitboard::andNot(const Bitboard &other)
+{
+    for(std::size_t i=0; i<m_bits.size(); ++i) {
+	m_bits[i] &= ~other.m_bits[i];
+    }
+    return *this;
+}
+
+Bitboard Bitboard::inverted() const
+{
+    Bitboard result(*this);
+    for(std::uint64_t &word : result.m_bits) {
+	word = ~word;
+    }
+    result.clearPadding();
+    return result;
+}
+
+/* Shifts a row one cell toward higher x (west neighbours move east), carrying
+   across words*/
+static void shiftEast(const std::uint64_t *in, std::uint64_t *out, int words)
+{
+    std::uint64_t carry = 0;
+    for(int i=0; i<words; ++i) {
+	out[i] = (in[i] << 1) | carry;
+	carry = in[i] >> (BitsPerWord - 1);
+    }
+}
+
+/* Shifts a row one cell toward lower x, carrying across words*/
+static void shiftWest(const std::uint64_t *in, std::uint64_t *out, int words)
+{
+    std::uint64_t carry = 0;
+    for(int i=words-1; i>=0; --i) {
+	out[i] = (in[i] >> 1) | carry;
+	carry = in[i] << (BitsPerWord - 1);
+    }
+}
+
+/* Grows the set cells by one cell in all 8 directions: each row is ORed with
+   its shifted copies, then with the rows above/below*/
+Bitboard Bitboard::dilated() const
+{
+    Bitboard across(m_width, m_height);
+    std::vector<std::uint64_t> east(m_rowWords), west(m_rowWords);
+    for(int y=0; y<m_height; ++y) {
+	shiftEast(row(y), east.data(), m_rowWords);
+	shiftWest(row(y), west.data(), m_rowWords);
+	for(int i=0; i<m_rowWords; ++i) {
+	    across.row(y)[i] = row(y)[i] | east[i] | west[i];
+	}
+    }
+    Bitboard result(m_width, m_height);
+    for(int y=0; y<m_height; ++y) {
+	for(int i=0; i<m_rowWords; ++i) {
+	    std::uint64_t word = across.row(y)[i];
+	    if(y > 0) word |= across.row(y - 1)[i];
+	    if(y < m_height - 1) word |= across.row(y + 1)[i];
+	    result.row(y)[i] = word;
+	}
+    }
+    result.clearPadding();
+    return result;
+}
+
+/* Counts all 8 neighbours of 64 cells at once: the neighbour rows are added
+   with bitwise full adders into four bit planes (ones/twos/fours/eights), so
+   each cell's count is spread across the same bit of the four planes*/
+Bitboard Bitboard::neighboursAtLeast(int count) const
+{
+    Bitboard result(m_width, m_height);
+    if(count <= 0) {
+	return result.inverted();
+    }
+    std::vector<std::uint64_t> zero(m_rowWords, 0);
+    std::vector<std::uint64_t> shifted[6];
+    for(std::vector<std::uint64_t> &words : shifted) {
+	words.resize(m_rowWords);
+    }
+    for(int y=0; y<m_height; ++y) {
+	const std::uint64_t *above = y > 0 ? row(y - 1) : zero.data();
+	const std::uint64_t *below = y < m_height - 1 ? row(y + 1) : zero.data();
+	shiftEast(above, shifted[0].data(), m_rowWords);
+	shiftWest(above, shifted[1].data(), m_rowWords);
+	shiftEast(row(y), shifted[2].data(), m_rowWords);
+	shiftWest(row(y), shifted[3].data(), m_rowWords);
+	shiftEast(below, shifted[4].data(), m_rowWords);
+	shiftWest(below, shifted[5].data(), m_rowWords);
+	for(int i=0; i<m_rowWords; ++i) {
+	    const std::uint64_t neighbours[8] = {above[i], below[i], shifted[0][i], shifted[1][i],
+						 shifted[2][i], shifted[3][i], shifted[4][i],
+						 shifted[5][i]};
+	    std::uint64_t ones = 0, twos = 0, fours = 0, eights = 0;
+	    for(std::uint64_t bit : neighbours) {
+		std::uint64_t carry = ones & bit;
+		ones ^= bit;
+		std::uint64_t carry2 = twos & carry;
+		twos ^= carry;
+		eights |= fours & carry2;
+		fours ^= carry2;
+	    }
+	    //Compare the 4-bit count in each lane against count
+	    std::uint64_t atLeast = 0;
+	    for(int n=count; n<=8; ++n) {
+		atLeast |= (n & 1 ? ones : ~ones) & (n & 2 ? twos : ~twos)
+		    & (n & 4 ? fours : ~fours) & (n & 8 ? eights : ~eights);
+	    }
+	    result.row(y)[i] = atLeast;
+	}
+    }
+    result.clearPadding();
+    return result;
+}
+
+/* Spreads set cells in fill east along the runs of open cells they're in,
+   log2(64) shifts per word (an occluded fill) rather than a cell at a time*/
+static std::uint64_t fillEast(std::uint64_t fill, std::uint64_t open)
+{
+    for(int shift=1; shift<BitsPerWord; shift*=2) {
+	fill |= open & (fill << shift);
+	open &= open << shift;
+    }
+    return fill;
+}
+
+static std::uint64_t fillWest(std::uint64_t fill, std::uint64_t open)
+{
+    for(int shift=1; shift<BitsPerWord; shift*=2) {
+	fill |= open & (fill >> shift);
+	open &= open >> shift;
+    }
+    return fill;
+}
+
+/* Fills a row's runs of open cells that contain a set cell of fill: east
+   across the words, carrying into the next word, then back west*/
+static void fillRow(std::uint64_t *fill, const std::uint64_t *open, int words)
+{
+    std::uint64_t carry = 0;
+    for(int i=0; i<words; ++i) {
+	std::uint64_t word = fill[i] | (carry & open[i]);
+	word = fillEast(word, open[i]);
+	fill[i] = fillWest(word, open[i]);
+	carry = fill[i] >> (BitsPerWord - 1);
+    }
+    carry = 0;
+    for(int i=words-1; i>=0; --i) {
+	fill[i] = fillWest(fill[i] | (carry & open[i]), open[i]);
+	carry = (fill[i] & 1) << (BitsPerWord - 1);
+    }
+}
+
+/* Sweeps down then up the rows, each row taking the cells diagonally/directly
+   next to the fill in the row before it and filling along its runs, until a
+   pair of sweeps adds nothing; most maps need only a few sweeps*/
+Bitboard Bitboard::floodFill(int x, int y) const
+{
+    Bitboard fill(m_width, m_height);
+    if(!test(x, y)) {
+	return fill;
+    }
+    fill.set(x, y);
+    fillRow(fill.row(y), row(y), m_rowWords);
+    std::vector<std::uint64_t> east(m_rowWords), west(m_rowWords);
+    //Adds the neighbours of the fill in row from to row to
+    auto spread = [&](int from, int to) {
+	shiftEast(fill.row(from), east.data(), m_rowWords);
+	shiftWest(fill.row(from), west.data(), m_rowWords);
+	bool grew = false;
+	std::uint64_t *words = fill.row(to);
+	const std::uint64_t *open = row(to);
+	for(int i=0; i<m_rowWords; ++i) {
+	    std::uint64_t reached = (fill.row(from)[i] | east[i] | west[i]) & open[i];
+	    grew |= (reached & ~words[i]) != 0;
+	    words[i] |= reached;
+	}
+	if(grew) {
+	    fillRow(words, open, m_rowWords);
+	}
+	return grew;
+    };
+    bool grew = true;
+    while(grew) {
+	grew = false;
+	for(int line=1; line<m_height; ++line) {
+	    grew |= spread(line - 1, line);
+	}
+	for(int line=m_height-2; line>=0; --line) {
+	    grew |= spread(line + 1, line);
+	}
+    }
+    return fill;
+}
+
+/* Walks the cells between the two ends along their Bresenham ray*/
+bool Bitboard::lineBlocked(int x0, int y0, int x1, int y1) const
+{
+    for(const RayStep &step : Ray(x1 - x0, y1 - y0)) {
+	int x = x0 + step.dx, y = y0 + step.dy;
+	if(x == x1 && y == y1) {
+	    return false;
+	}
+	if(test(x, y)) {
+	    return true;
+	}
+    }
+    return false;
+}
+
+/* Sets the cells that aren't empty (non-zero) in a map layer*/
+Bitboard Bitboard::fromLayer(const LevelMap &layer)
+{
+    Bitboard result(layer.width(), layer.height());
+    for(int y=0; y<layer.height(); ++y) {
+	const char *tiles = layer[y];
+	std::uint64_t *words = result.row(y);
+	for(int x=0; x<layer.width(); ++x) {
+	    words[x / BitsPerWord] |= std::uint64_t(tiles[x] != 0) << (x % BitsPerWord);
+	}
+    }
+    return result;
+}
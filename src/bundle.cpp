@@ -0,0 +1,215 @@
+#include "include/bundle.h"
+#include "include/mappedfile.h"
+#include "include/template.h"
+#include "include/trace.h"
+#include <cstring>
+#include <fstream>
+
+//Bundle layout: BundleHeader, monsterCount MonsterRecords, itemCount
+//ItemRecords, then every name's chars back to back. It's written/read as
+//raw structs by the same build, so the header records their sizes too
+struct BundleHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t headerSize, monsterSize, itemSize;
+    //Stamps of the INI files; a mismatch means the bundle is stale
+    std::uint64_t monstersStamp, itemsStamp;
+    std::uint32_t monsterCount, itemCount;
+    std::uint32_t namesSize;
+};
+
+struct MonsterRecord {
+    char ch;
+    std::uint8_t elite;
+    std::int16_t energy, health, carryWeight, maxCarryWeight, level, levelProgress;
+    std::int16_t strength, cunning, agility, education;
+    std::int16_t sidearmSkill, longarmSkill, meleeSkill, barterSkill, negotiateSkill;
+    std::uint32_t nameOffset, nameSize;
+};
+
+struct ItemRecord {
+    char ch;
+    std::uint8_t melee, ranged;
+    std::int16_t weight, attack, armor;
+    std::uint32_t nameOffset, nameSize;
+};
+
+constexpr char BundleMagic[4] = {'R', 'P', 'G', 'T'};
+
+std::string monstersPath(const std::string &dir) { return dir + "src/monsters.ini"; }
+std::string itemsPath(const std::string &dir) { return dir + "src/items.ini"; }
+std::string bundlePath(const std::string &dir) { return dir + "src/templates.bin"; }
+
+static void addErrors(std::vector<std::string> &out, const std::string &file,
+		      const std::vector<TemplateError> &errors)
+{
+    for(const TemplateError &error : errors) {
+	out.push_back(file + ":" + std::to_string(error.line) + ": " + error.message);
+    }
+}
+
+/* Parses the INI template files in the game's directory*/
+TemplateSet loadTemplateSetFromIni(const std::string &dir)
+{
+    return loadTemplateSetFromIni(monstersPath(dir), itemsPath(dir));
+}
+
+static std::string fileName(const std::string &path)
+{
+    return path.substr(path.find_last_of("/\\") + 1);
+}
+
+/* Parses the given INI template files*/
+TemplateSet loadTemplateSetFromIni(const std::string &monstersFile, const std::string &itemsFile)
+{
+    TemplateSet templates;
+    std::vector<TemplateError> monsterErrors, itemErrors;
+    templates.monsters = loadMonsterTemplates(std::string(monstersFile), &monsterErrors);
+    templates.items = loadItemTemplates(std::string(itemsFile), &itemErrors);
+    addErrors(templates.errors, fileName(monstersFile), monsterErrors);
+    addErrors(templates.errors, fileName(itemsFile), itemErrors);
+    return templates;
+}
+
+/* Loads templates from the bundle if it's up to date with the INI files,
+   otherwise from the INI files themselves*/
+TemplateSet loadTemplateSet(const std::string &dir)
+{
+    TRACE_SCOPE("loadTemplateSet");
+    TemplateSet templates;
+    if(readTemplateBundle(dir, templates)) {
+	return templates;
+    }
+    return loadTemplateSetFromIni(dir);
+}
+
+/* Fills templates from the bundle without parsing anything; returns false
+   (leaving templates alone) if there's no bundle, it's from another
+   version/build, or the INI files changed since it was written*/
+bool readTemplateBundle(const std::string &dir, TemplateSet &templates)
+{
+    TRACE_SCOPE("readTemplateBundle");
+    MappedFile file(bundlePath(dir));
+    StringRef contents = file.contents();
+    BundleHeader header;
+    if(!file.isOpen() || contents.size() < sizeof(header)) {
+	return false;
+    }
+    std::memcpy(&header, contents.data(), sizeof(header));
+    std::size_t expectedSize = sizeof(header) + header.monsterCount * sizeof(MonsterRecord)
+	+ header.itemCount * sizeof(ItemRecord) + header.namesSize;
+    if(std::memcmp(header.magic, BundleMagic, sizeof(BundleMagic)) != 0
+       || header.version != BundleVersion || header.headerSize != sizeof(BundleHeader)
+       || header.monsterSize != sizeof(MonsterRecord) || header.itemSize != sizeof(ItemRecord)
+       || contents.size() != expectedSize
+       || header.monstersStamp != fileStamp(monstersPath(dir))
+       || header.itemsStamp != fileStamp(itemsPath(dir))) {
+	return false;
+    }
+
+    const char *monsters = contents.data() + sizeof(header);
+    const char *items = monsters + header.monsterCount * sizeof(MonsterRecord);
+    const char *names = items + header.itemCount * sizeof(ItemRecord);
+    TemplateSet loaded;
+    for(std::uint32_t i=0; i<header.monsterCount; ++i) {
+	MonsterRecord record;
+	std::memcpy(&record, monsters + i * sizeof(record), sizeof(record));
+	if(record.nameOffset + record.nameSize > header.namesSize) {
+	    return false;
+	}
+	Actor &monster = loaded.monsters[record.ch];
+	monster.setCh(record.ch);
+	monster.setName(std::string(names + record.nameOffset, record.nameSize));
+	monster.setEnergy(record.energy);
+	monster.addHealth(record.health - monster.getHealth());
+	monster.setElite(record.elite != 0);
+	monster.m_carryWeight = record.carryWeight;
+	monster.m_maxCarryWeight = record.maxCarryWeight;
+	monster.m_level = record.level;
+	monster.m_levelProgress = record.levelProgress;
+	monster.m_strength = record.strength;
+	monster.m_cunning = record.cunning;
+	monster.m_agility = record.agility;
+	monster.m_education = record.education;
+	monster.m_sidearmSkill = record.sidearmSkill;
+	monster.m_longarmSkill = record.longarmSkill;
+	monster.m_meleeSkill = record.meleeSkill;
+	monster.m_barterSkill = record.barterSkill;
+	monster.m_negotiateSkill = record.negotiateSkill;
+    }
+    for(std::uint32_t i=0; i<header.itemCount; ++i) {
+	ItemRecord record;
+	std::memcpy(&record, items + i * sizeof(record), sizeof(record));
+	if(record.nameOffset + record.nameSize > header.namesSize) {
+	    return false;
+	}
+	Item &item = loaded.items[record.ch];
+	item.setName(std::string(names + record.nameOffset, record.nameSize));
+	item.setWeight(record.weight);
+	item.setAttack(record.attack);
+	item.setArmor(record.armor);
+	item.setMelee(record.melee != 0);
+	item.setRanged(record.ranged != 0);
+    }
+    loaded.fromBundle = true;
+    templates = std::move(loaded);
+    return true;
+}
+
+static std::uint32_t addName(std::string &names, const std::string &name)
+{
+    std::uint32_t offset = names.size();
+    names += name;
+    return offset;
+}
+
+/* Parses the INI files and writes them out as a bundle; refuses (returning
+   false) if the INI files have errors, since the bundle couldn't report them*/
+bool writeTemplateBundle(const std::string &dir, std::vector<std::string> &errors)
+{
+    TemplateSet templates = loadTemplateSetFromIni(dir);
+    if(!templates.errors.empty()) {
+	errors = templates.errors;
+	return false;
+    }
+
+    std::vector<MonsterRecord> monsters;
+    std::vector<ItemRecord> items;
+    std::string names;
+    for(const auto &entry : templates.monsters) {
+	const Actor &monster = entry.second;
+	monsters.push_back(MonsterRecord{entry.first, monster.isElite(),
+		    static_cast<std::int16_t>(monster.getEnergy()),
+		    static_cast<std::int16_t>(monster.getHealth()),
+		    monster.m_carryWeight, monster.m_maxCarryWeight, monster.m_level,
+		    monster.m_levelProgress, monster.m_strength, monster.m_cunning,
+		    monster.m_agility, monster.m_education, monster.m_sidearmSkill,
+		    monster.m_longarmSkill, monster.m_meleeSkill, monster.m_barterSkill,
+		    monster.m_negotiateSkill, addName(names, monster.getName()),
+		    static_cast<std::uint32_t>(monster.getName().size())});
+    }
+    for(const auto &entry : templates.items) {
+	const Item &item = entry.second;
+	items.push_back(ItemRecord{entry.first, item.isMelee(), item.isRanged(),
+		    static_cast<std::int16_t>(item.getWeight()), item.getAttack(),
+		    item.getArmor(), addName(names, item.getName()),
+		    static_cast<std::uint32_t>(item.getName().size())});
+    }
+
+    BundleHeader header{{BundleMagic[0], BundleMagic[1], BundleMagic[2], BundleMagic[3]},
+			BundleVersion, sizeof(BundleHeader), sizeof(MonsterRecord),
+			sizeof(ItemRecord), fileStamp(monstersPath(dir)), fileStamp(itemsPath(dir)),
+			static_cast<std::uint32_t>(monsters.size()),
+			static_cast<std::uint32_t>(items.size()),
+			static_cast<std::uint32_t>(names.size())};
+    std::ofstream out(bundlePath(dir), std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(monsters.data()), monsters.size() * sizeof(MonsterRecord));
+    out.write(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(ItemRecord));
+    out.write(names.data(), names.size());
+    if(!out) {
+	errors.push_back("could not write " + bundlePath(dir));
+	return false;
+    }
+    return true;
+}
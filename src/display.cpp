@@ -1,7 +1,11 @@
 #include <iostream>
 #include "include/display.h"
 #include "include/actor.h"
+#include "include/tiles.h"
+#include "include/trace.h"
 #include <algorithm>
+#include <iomanip>
+#include <sstream>
 
 //Map should take up at least min screen space so min-size screen is always full
 static_assert(MapWidth >= MinDisplayWidth && MapHeight >= MinDisplayHeight, "Map too small");
@@ -14,7 +18,7 @@ Display::Display()
     : m_cursorX(-1), m_cursorY(-1), m_screenWidth(0), m_screenHeight(0),
       m_cornerX(0), m_cornerY(0), m_event{0, 0, 0, 0, 0, 0, 0, 0},
       m_textCol(0), m_textX(0), m_textY(0), m_textMaxWidth(0),
-      m_log{}, m_logRow(0)
+      m_log{}, m_logRow(0), m_headless(false), m_headlessWidth(0), m_headlessHeight(0)
 {
     int errorStatus = tb_init();
     if(errorStatus < 0) {
@@ -30,10 +34,36 @@ Display::Display()
     m_screenHeight = std::min(boardHeight(), MapHeight);
 }
 
+/* Creates a display of the given size that draws into memory instead of
+   the terminal (e.g. for benchmarks); never has any input*/
+Display::Display(int width, int height)
+    : m_cursorX(-1), m_cursorY(-1), m_screenWidth(0), m_screenHeight(0),
+      m_cornerX(0), m_cornerY(0), m_event{0, 0, 0, 0, 0, 0, 0, 0},
+      m_textCol(0), m_textX(0), m_textY(0), m_textMaxWidth(0),
+      m_log{}, m_logRow(0), m_headless(true), m_headlessWidth(width),
+      m_headlessHeight(height), m_cells(width * height)
+{
+    clear();
+    m_screenWidth = std::min(boardWidth(), MapWidth);
+    m_screenHeight = std::min(boardHeight(), MapHeight);
+}
+
 Display::~Display()
 {
     //Makes terminal usable after program ends
-    tb_shutdown();
+    if(!m_headless) {
+	tb_shutdown();
+    }
+}
+
+/* Empties the screen buffer*/
+void Display::clear()
+{
+    if(m_headless) {
+	std::fill(m_cells.begin(), m_cells.end(), tb_cell{' ', TB_DEFAULT, TB_DEFAULT});
+    } else {
+	tb_clear();
+    }
 }
 
 /* Converts coordinates written in terms of game map (the 2d array maintained
@@ -50,6 +80,9 @@ int Display::convertCoord(int coord, bool isX)
    checking occurs*/
 bool Display::getInput()
 {
+    if(m_headless) {
+	return false;
+    }
     return tb_peek_event(&m_event, InputTimeout) > -1;
 }
 
@@ -59,15 +92,17 @@ bool Display::isEmpty(int x, int y)
 {
     int row = convertCoord(y, false);
     int col = convertCoord(x, true);
-    tb_cell *buffer = tb_cell_buffer();
-    return buffer[(tb_width() * row) + col].ch == EmptySpace;
+    tb_cell *buffer = m_headless ? m_cells.data() : tb_cell_buffer();
+    return buffer[(width() * row) + col].ch == EmptySpace;
 }
 
 void Display::moveCursor(int x, int y)
 {
     m_cursorY = convertCoord(y, false);
     m_cursorX = convertCoord(x, true);
-    tb_set_cursor(m_cursorX, m_cursorY);
+    if(!m_headless) {
+	tb_set_cursor(m_cursorX, m_cursorY);
+    }
 }
 
 void Display::translateCursor(int dx, int dy)
@@ -75,13 +110,17 @@ void Display::translateCursor(int dx, int dy)
     if(m_cursorX != -1 && m_cursorY != -1) {
 	m_cursorY += dy;
 	m_cursorX += dx;
-	tb_set_cursor(m_cursorX, m_cursorY);
+	if(!m_headless) {
+	    tb_set_cursor(m_cursorX, m_cursorY);
+	}
     }
 }
 
 void Display::hideCursor()
 {
-    tb_set_cursor(TB_HIDE_CURSOR, TB_HIDE_CURSOR);
+    if(!m_headless) {
+	tb_set_cursor(TB_HIDE_CURSOR, TB_HIDE_CURSOR);
+    }
     m_cursorX = -1;
     m_cursorY = -1;
 }
@@ -97,7 +136,14 @@ void Display::clearChar(int col, int row)
 void Display::putChar(int col, int row, const char letter,
 		      const uint16_t fg, const uint16_t bg)
 {
-    tb_change_cell(col, row, static_cast<uint32_t>(letter), fg, bg);
+    m_perf.countCell();
+    if(m_headless) {
+	if(col >= 0 && col < m_headlessWidth && row >= 0 && row < m_headlessHeight) {
+	    m_cells[row * m_headlessWidth + col] = tb_cell{static_cast<uint32_t>(letter), fg, bg};
+	}
+    } else {
+	tb_change_cell(col, row, static_cast<uint32_t>(letter), fg, bg);
+    }
 }
 
 /* Writes a string onscreen, starting at the given coords (in terms of
@@ -108,7 +154,7 @@ void Display::printText(int col, int row, const std::string text,
 			const uint16_t fg, const uint16_t bg)
 {
     //Validate coordinates
-    if(col < 0 || col > tb_width() || row < 0 || row > tb_height()) {
+    if(col < 0 || col > width() || row < 0 || row > height()) {
 	return;
     }
     int x = col;
@@ -116,7 +162,7 @@ void Display::printText(int col, int row, const std::string text,
     for(std::string::size_type i=0; i<text.length(); ++i) {
 	putChar(x, y, text[i], fg, bg);
 	++x;
-	if(x >= tb_width()) {
+	if(x >= width()) {
 	    x = col;
 	    ++y;
 	}
@@ -217,10 +263,9 @@ void Display::printTextCol(int gridCol, const std::string text,
 /* Gets position of top-left corner of screen so that the screen buffer
    (a slice of the game map) stays centered over the player, locking to the
    edges when the player approaches the map edge */
-int Display::getCameraCoord(int playerCoord, bool isX)
+int Display::getCameraCoord(int playerCoord, int mapSize, bool isX)
 {
     int screenSize = isX ? m_screenWidth : m_screenHeight;
-    int mapSize = isX ? MapWidth : MapHeight;
     if(playerCoord < screenSize / 2) {
 	return 0;
     } else if(playerCoord >= mapSize - screenSize / 2) {
@@ -230,6 +275,27 @@ int Display::getCameraCoord(int playerCoord, bool isX)
     }
 }
 
+static std::string formatted(double value, int precision = 1)
+{
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(precision) << value;
+    return text.str();
+}
+
+/* Adds the performance overlay (rolling averages) as another GUI column*/
+void Display::drawPerf()
+{
+    printTextCol(2, "Perf: (p to hide)", TB_YELLOW);
+    printTextCol(2, " Frame: " + formatted(m_perf.frameMs()) + " ms");
+    printTextCol(2, " Turn: " + formatted(m_perf.turnMs(), 2) + " ms");
+    printTextCol(2, " Actors/tick: " + formatted(m_perf.actorsPerTick()));
+    printTextCol(2, " Cells/present: " + formatted(m_perf.cellsPerPresent(), 0));
+    printTextCol(2, " Allocs/frame: " + (CountingAllocations ? formatted(m_perf.allocationsPerFrame())
+					: std::string("n/a")));
+    printTextCol(2, " RSS: " + formatted(m_perf.memoryKb() / 1024.0) + " MB");
+    printTextCol(2, " Startup: " + formatted(m_perf.startupMs()) + " ms");
+}
+
 /* Adds labels/information shown to player in sidebars onscreen to screen
    buffer, respecting the area used to draw the area around the player */
 void Display::drawGUI(const Actor &player)
@@ -237,10 +303,13 @@ void Display::drawGUI(const Actor &player)
     printTextCol(1, "You:", TB_YELLOW);
     printTextCol(1, " Name: " + player.getName());
     printTextCol(1, " Energy: " + std::to_string(player.getEnergy()));
+    if(m_perf.visible()) {
+	drawPerf();
+    }
 
     //Draw event log
     int row = 0;
-    while(row < tb_height() && row < m_logRow) {
+    while(row < height() && row < m_logRow) {
 	printText(m_screenWidth, row, m_log[row]);
 	++row;
     }
@@ -252,32 +321,50 @@ void Display::drawGUI(const Actor &player)
     m_textMaxWidth = 0;
 }
 
+/* Pushes the screen buffer to the terminal*/
+void Display::present()
+{
+    TRACE_SCOPE("tb_present");
+    if(!m_headless) {
+	tb_present();
+    }
+    m_perf.endFrame();
+}
+
 /* Places all non-empty tiles centered around the player into the screen buffer,
    stopping when there is no more room. Respects area left for GUI */
-void Display::draw(const LevelMap &map, const Actor &player)
+void Display::draw(const LayeredMap &map, const TileTable &tiles, const Actor &player)
 {
+    TRACE_SCOPE("Display::draw");
     //Screen may be smaller than map, so display as much as possible
-    m_screenWidth = std::min(boardWidth(), MapWidth);
-    m_screenHeight = std::min(boardHeight(), MapHeight);
+    m_screenWidth = std::min(boardWidth(), map.width());
+    m_screenHeight = std::min(boardHeight(), map.height());
     //Calculate where to start drawing from so player stays centered (if possible)
-    m_cornerX = getCameraCoord(player.getX(), true);
-    m_cornerY = getCameraCoord(player.getY(), false);
+    m_cornerX = getCameraCoord(player.getX(), map.width(), true);
+    m_cornerY = getCameraCoord(player.getY(), map.height(), false);
     for(int y=m_cornerY; y<(m_cornerY+m_screenHeight); ++y) {
 	for(int x=m_cornerX; x<(m_cornerX+m_screenWidth); ++x) {
 	    int col = convertCoord(x, true);
 	    int row = convertCoord(y, false);
-	    if(map[y][x] != 0) {
-		putChar(col, row, map[y][x]);
-	    } else {
-		putChar(col, row, EmptySpace);
-	    }
+	    putChar(col, row, tiles[map.top(x, y)].glyph);
 	}
     }
     drawGUI(player);
 }
 
+/* Redraws a map cell in other colors (e.g. to show a line of fire), if
+   it's onscreen*/
+void Display::highlight(int x, int y, char glyph, const uint16_t fg, const uint16_t bg)
+{
+    if(x < m_cornerX || x >= m_cornerX + m_screenWidth
+       || y < m_cornerY || y >= m_cornerY + m_screenHeight) {
+	return;
+    }
+    putChar(convertCoord(x, true), convertCoord(y, false), glyph, fg, bg);
+}
+
 /* Checks if window is large enough to adequately display the game */
 bool Display::largeEnough()
 {
-    return tb_width() >= MinDisplayWidth && tb_height() >= MinDisplayHeight;
+    return width() >= MinDisplayWidth && height() >= MinDisplayHeight;
 }
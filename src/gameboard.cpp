@@ -1,5 +1,13 @@
 #include "include/gameboard.h"
+#include "include/zobrist.h"
+#include "include/lookahead.h"
+#include "include/bundle.h"
+#include "include/trace.h"
+#include "include/rays.h"
+#include <algorithm>
 #include <fstream>
+#include <iostream>
+#include <iterator>
 #include <cmath>
 
 std::string getLocalDir();
@@ -13,145 +21,353 @@ static int distanceFrom(int x1, int y1, int x2, int y2)
     return std::abs(std::sqrt((x1-x2)*(x1-x2) + (y1-y2)*(y1-y2)));
 }
 
+/* Reads tiles from given map file (a CSV of chars, 0 for empty) into a map
+   of the default size; exits if the file can't be opened*/
+static LevelMap readMapFile(Display *screen, const std::string &path)
+{
+    TRACE_SCOPE("readMapFile");
+    std::ifstream mapFile(path);
+    if(!mapFile) {
+	if(screen) {
+	    screen->printText(0, 0, "Error: could not load map file: " + path + "\n");
+	    screen->input("Press Enter to exit", 0, 1);
+	} else {
+	    std::cerr << "Error: could not load map file: " << path << "\n";
+	}
+	exit(1);
+    }
+
+    LevelMap tiles;
+    int row = 0;
+    while(mapFile && row < tiles.height())
+    {
+	std::string line;
+	std::getline(mapFile, line);
+	int col = 0;
+	for(std::string::size_type pos=0; pos<line.size(); ++pos) {
+	    if(col >= tiles.width()) {
+		break;
+	    }
+	    if(line[pos] == ',' || line[pos] == '\n' || line[pos] == '\r') {
+		continue;
+	    } else if(line[pos] != '0') {
+		tiles[row][col] = line[pos];
+	    }
+	    ++col;
+	}
+	++row;
+    }
+    return tiles;
+}
+
 /* Creates a new board linking to the termbox screen; opens/loads
-   the given map, and sets up in-game GUI*/
-GameBoard::GameBoard(Display &screen, Actor playerCh, const std::string &mapPath)
-    : m_map{}, m_screen(screen), m_player_index(0), m_turn_index(0),
-      m_templates{loadMonsterTemplates(getLocalDir() + "src/monsters.ini")},
-      m_itemTemplates{loadItemTemplates(getLocalDir() + "src/items.ini")}
+   the given map, and sets up in-game GUI. With no screen (nullptr), the
+   board runs headless: nothing is drawn and log messages are kept for
+   takeMessages(). Boards with the same seed play out the same way*/
+GameBoard::GameBoard(Display *screen, Actor playerCh, const std::string &mapPath,
+		     unsigned int seed)
+    : GameBoard(screen, playerCh, readMapFile(screen, mapPath), seed)
 {
-    m_items.reserve(ItemVecDefaultSize);
-    m_actors.reserve(ActorVecDefaultSize);
+}
 
+/* Creates a new board like above, but starting on the given tiles (e.g. a
+   generated map) instead of a map file*/
+GameBoard::GameBoard(Display *screen, Actor playerCh, const LevelMap &tiles,
+		     unsigned int seed)
+    : m_travelling(false), m_changed(false), m_cursorAction(nullptr), m_screen(screen), m_player_index(0), m_turn_index(0),
+      m_activityRadius(ActivityRadius), m_sleepRadius(SleepRadius), m_hunted(false),
+      m_items(ArenaAllocator<Item>(&m_arena)), m_actors(ArenaAllocator<Actor>(&m_arena)),
+      m_hash(0), m_searchThreads(ThreadPool::defaultThreadCount()), m_lookaheadRollouts(0),
+      m_searchesLeft(0),
+      m_generator(seed), m_nextItemId(0), m_updateLiveTemplates(false)
+{
+    TemplateSet templates = loadTemplateSet(getLocalDir());
+    m_tiles.build(templates.monsters, templates.items);
     m_actors.push_back(playerCh);
     m_turn_index = m_player_index;
 
-    loadMap(mapPath);
+    loadMap(tiles);
     //When doing turns, will start iterating through m_actors backward
     //so deletions of Actors are easy/safe; however, 1st turn should be the
     //player's
     player().setTurn(true);
+    m_hash = computeHash();
+    beginTurn();
+    for(const std::string &error : templates.errors) {
+	log(error);
+    }
     //Show initial map, centered at player's current position
-    m_screen.draw(m_map, player());
+    refresh();
 }
 
 /* Fills 2d array with tiles from given map file, instantiating
    new Actors/other entities as needed in their correct positions*/
 void GameBoard::loadMap(const std::string &path)
 {
-    //First, make all tiles empty tiles
-    for(int row=0; row<MapHeight; ++row) {
-	for(int col=0; col<MapWidth; ++col) {
-	    m_map[row][col] = 0;
+    loadMap(readMapFile(m_screen, path));
+}
+
+/* Replaces the board with the given tiles (of any size), instantiating
+   new Actors/other entities as needed in their correct positions*/
+void GameBoard::loadMap(const LevelMap &tiles)
+{
+    TRACE_SCOPE("GameBoard::loadMap");
+    //Only the player carries over from the previous map; the rest of the
+    //old level goes at once, with its Arena
+    Actor playerCopy = player();
+    m_actors = ActorList(ArenaAllocator<Actor>(&m_arena));
+    m_items = ItemList(ArenaAllocator<Item>(&m_arena));
+    m_arena.reset();
+    //Room for everything on the map up front, so the lists don't leave
+    //outgrown copies behind in the Arena
+    int monsters = 0, items = 0;
+    for(int row=0; row<tiles.height(); ++row) {
+	for(int col=0; col<tiles.width(); ++col) {
+	    const TileInfo &tile = m_tiles[tiles[row][col]];
+	    monsters += tile.kind == TileKind::MONSTER;
+	    items += tile.kind == TileKind::ITEM && tile.templateId >= 0;
 	}
     }
-    std::ifstream mapFile(path);
-    if(!mapFile) {
-	m_screen.printText(0, 0, "Error: could not load map file: " + path + "\n");
-	m_screen.input("Press Enter to exit", 0, 1);
-	exit(1);
-    }
+    m_actors.reserve(monsters + ActorVecDefaultSize);
+    m_items.reserve(items + ItemVecDefaultSize);
+    const ArenaAllocator<Item> inventories(&m_arena);
+    m_actors.push_back(playerCopy);
+    m_actors.back().useAllocator(inventories);
+    numberItems(m_actors.back());
+    m_player_index = 0;
+    m_turn_index = 0;
+    m_map = LayeredMap(tiles.width(), tiles.height());
+    //Turns on the old map can't be undone on the new one
+    m_history.clear();
 
-    //Next, populate map/m_actors list with data from map file
-    int row = 0;
-    while(mapFile && row < MapHeight)
-    {
-	std::string line;
-	std::getline(mapFile, line);
-	int col = 0;
-	for(std::string::size_type pos=0; pos<line.size(); ++pos) {
-	    if(col >= MapWidth) {
+    //Populate m_actors/m_items list from the tiles
+    for(int row=0; row<m_map.height(); ++row) {
+	for(int col=0; col<m_map.width(); ++col) {
+	    char ch = tiles[row][col];
+	    const TileInfo &tile = m_tiles[ch];
+	    //All Actors need to be in m_actors list/have char in the actor layer
+	    switch(tile.kind) {
+	    case TileKind::EMPTY:
+		break;
+	    case TileKind::PLAYER:
+		//Need to have accurate positioning for player object
+		player().move(col, row);
+		player().setCh(PlayerTile);
+		m_map.layer(MapLayer::ACTORS)[row][col] = ch;
+		break;
+	    case TileKind::MONSTER: {
+		//Create monster mapped from given char
+		Actor monster = m_tiles.monsters()[tile.templateId];
+		monster.move(col, row);
+		m_actors.push_back(monster);
+		m_actors.back().useAllocator(inventories);
+		m_map.layer(MapLayer::ACTORS)[row][col] = ch;
 		break;
 	    }
-	    if(line[pos] == ',' || line[pos] == '\n' || line[pos] == '\r') {
-		continue;
-	    } else if(line[pos] == '0') {
-		++col;
-	    } else {
-		//All Actors need to be in m_actors list/have char in m_map
-		m_map[row][col] = line[pos];
-		if(line[pos] == PlayerTile) {
-		    //Need to have accurate positioning for player object
-		    player().move(col, row);
-		    player().setCh(PlayerTile);
-		} else if(m_itemTemplates.find(line[pos]) != m_itemTemplates.end()) {
-		    Item item = m_itemTemplates[line[pos]];
+	    case TileKind::ITEM:
+		if(tile.templateId >= 0) {
+		    Item item = m_tiles.items()[tile.templateId];
 		    item.move(col, row);
+		    item.setId(m_nextItemId++);
 		    //Add Item to Item list
 		    m_items.push_back(item);
-		} else if(m_templates.find(line[pos]) != m_templates.end()) {
-		    //If in template list, create monster mapped from given char
-		    Actor monster = m_templates[line[pos]];
-		    monster.move(col, row);
-		    m_actors.push_back(monster);
+		    m_map.layer(MapLayer::ITEMS)[row][col] = ch;
+		    break;
 		}
-		++col;
+		//Items without a template are just scenery
+		m_map.layer(MapLayer::TERRAIN)[row][col] = ch;
+		break;
+	    default:
+		m_map.layer(MapLayer::TERRAIN)[row][col] = ch;
+		break;
 	    }
 	}
-	++row;
+    }
+    rebuildBitboards();
+    checkReachable();
+    m_explored = Bitboard(m_map.width(), m_map.height());
+    markSeen();
+    m_hash = computeHash();
+    m_awake.clear();
+    m_perception.clear();
+    m_wakeEvents = decltype(m_wakeEvents)();
+    updateActivity();
+}
+
+/* Gives the Items an Actor brought onto the board (e.g. the player's
+   starting ones) ids; those carried over from an earlier map keep theirs*/
+void GameBoard::numberItems(Actor &actor)
+{
+    for(int i=0; i<actor.getInventorySize(); ++i) {
+	Item *item = actor.getItemAt(i);
+	if(item->getId() < 0) {
+	    item->setId(m_nextItemId++);
+	}
+    }
+    for(int i=0; i<EQUIP_MAX; ++i) {
+	Item *item = actor.getEquipped(i);
+	if(item != nullptr && item->getId() < 0) {
+	    item->setId(m_nextItemId++);
+	}
     }
 }
 
+/* Places a new monster made from the template for the given char at an
+   empty position; returns false if there's no such template or the
+   position is taken*/
+bool GameBoard::spawnMonster(char ch, int x, int y)
+{
+    const Actor *temp = m_tiles.monster(ch);
+    if(!temp || !isValid(x, y) || !isOpen(x, y)) {
+	return false;
+    }
+    Actor monster = *temp;
+    monster.move(x, y);
+    m_history.recordActorAdded(m_actors.size());
+    m_actors.push_back(monster);
+    m_actors.back().useAllocator(ArenaAllocator<Item>(&m_arena));
+    m_hash ^= actorKey(m_actors.back());
+    setTile(MapLayer::ACTORS, x, y, ch);
+    m_actorGrid[y * m_map.width() + x] = m_actors.size() - 1;
+    factionCells(m_actors.back()).set(x, y);
+    m_perception.push_back(Perception{false, 0, 0, -1, -1});
+    if(distanceFrom(x, y, player().getX(), player().getY()) <= m_activityRadius) {
+	m_awake.push_back(m_actors.size() - 1);
+    }
+    return true;
+}
+
 /* Toggles cursor on/off; calls function pointer/disables cursor when called
    and cursor active*/
 void GameBoard::bindCursorMode(Actor &actor, bool (GameBoard::*action)(Actor&, int, int))
 {
+    if(!m_screen) return;
     //Put cursor at player position on first keypress
-    if(!m_screen.hasCursor()) {
-	m_screen.moveCursor(actor.getX(), actor.getY());
+    if(!m_screen->hasCursor()) {
+	m_screen->moveCursor(actor.getX(), actor.getY());
+	m_cursorAction = action;
     }
     //Execute action, passing cursor position, on second keypress
     else {
-	int cursorX = m_screen.getCursorX();
-	int cursorY = m_screen.getCursorY();
+	int cursorX = m_screen->getCursorX();
+	int cursorY = m_screen->getCursorY();
 	if(isValid(cursorX, cursorY)) {
 	    (this->*action)(actor, cursorX, cursorY);
-	    m_screen.hideCursor();
-	    m_screen.clear();
-	    m_screen.draw(m_map, player());
+	    m_screen->hideCursor();
+	    refresh();
 	}
     }
 }
 
-/* Calls update functions on all actors currently on the board,
-   working backwards so removing an actor doesn't skip anything*/
+/* Runs one game tick. During the player's turn, that's checking whether
+   they've used up their energy; once they have, the awake monsters take
+   their turn together, each taking one step per tick, until none can go
+   on and it's the player's turn again*/
 void GameBoard::updateActors()
 {
-    //Check if actor with current turn is done;
-    //if so, move turn to next actor, update screen
-    if(!currActor().isTurn()) {
-	if(--m_turn_index == -1) {
-	    m_turn_index = m_actors.size() - 1;
+    TRACE_SCOPE("GameBoard::updateActors");
+    PerfClock::time_point start = PerfClock::now();
+    if(m_turn_index == m_player_index) {
+	player().update(this);
+	if(!player().isTurn()) {
+	    beginMonstersTurn();
+	}
+    }
+    if(m_turn_index == MonstersTurn && !stepMonsters()) {
+	m_turn_index = m_player_index;
+	beginChange(player());
+	player().setTurn(true);
+	endChange(player());
+	beginTurn();
+	refresh();
+    }
+    if(m_screen) {
+	m_screen->perf().countTick(m_actors.size(), start);
+    }
+}
+
+/* Gives every awake monster its turn (and energy) at once, and starts the
+   clock on the time its elites may spend searching*/
+void GameBoard::beginMonstersTurn()
+{
+    m_turn_index = MonstersTurn;
+    m_lookaheadDeadline = SearchClock::now() + std::chrono::milliseconds(LookaheadBudgetMs);
+    for(int index : m_awake) {
+	Actor &monster = m_actors[index];
+	if(index != m_player_index && monster.isAlive()) {
+	    beginChange(monster);
+	    monster.setTurn(true);
+	    endChange(monster);
 	}
-	currActor().setTurn(true);
-	m_screen.clear();
-	m_screen.draw(m_map, player());
     }
+}
 
-    int i = m_turn_index;
-    do {
-	m_actors[i].update(this);
-	if(--i == -1) {
-	    i = m_actors.size() - 1;
+/* Has every monster whose turn it still is take a step, in two phases.
+   First they all plan their step at once, in parallel, against the board
+   as it stands, which nothing changes meanwhile. Then the plans are
+   carried out one at a time, in the same order as always (backwards from
+   the player, so it doesn't depend on the threads), each against the
+   board as the ones before left it; where two monsters head for the same
+   cell, the first gets there and the other has to go around. Returns
+   false if no monster had a turn left to take*/
+bool GameBoard::stepMonsters()
+{
+    TRACE_SCOPE("GameBoard::stepMonsters");
+    m_planned.clear();
+    for(int index : m_awake) {
+	Actor &monster = m_actors[index];
+	if(index == m_player_index || !monster.isTurn()) {
+	    continue;
+	}
+	if(monster.getEnergy() <= 0 || !monster.isAlive()) {
+	    monster.setTurn(false, monster.getEnergy());
+	} else {
+	    m_planned.push_back(index);
 	}
-    } while(i != m_turn_index);
+    }
+    if(m_planned.empty()) {
+	return false;
+    }
+    m_plans.resize(m_planned.size());
+    forChunks(m_planned.size(), PlanChunk, [this](int first, int last) {
+	for(int i=first; i<last; ++i) {
+	    m_plans[i] = m_actors[m_planned[i]].plan(*this);
+	}
+    });
+    m_searchesLeft = 0;
+    for(std::size_t i=0; i<m_planned.size(); ++i) {
+	if(m_plans[i].lookahead) {
+	    m_searchesLeft += m_actors[m_planned[i]].getEnergy();
+	}
+    }
+    const std::size_t count = m_planned.size();
+    std::size_t below = std::lower_bound(m_planned.begin(), m_planned.end(), m_player_index)
+	- m_planned.begin();
+    for(std::size_t k=1; k<=count; ++k) {
+	std::size_t pos = (below + count - k) % count;
+	if(m_planned[pos] >= 0) {
+	    commitPlan(m_actors[m_planned[pos]], m_plans[pos]);
+	}
+    }
+    return true;
 }
 
 /* Displays an actor's current inventory in subscreen; ESC/any redraws closes it*/
 void GameBoard::showInventory(Actor &actor)
 {
-    m_screen.printText(0, 0, actor.getName() + "'s Inventory: (ESC to exit)", TB_YELLOW);
-    m_screen.printText(0, 1, "E) Equip item, D) Deequip item", TB_YELLOW);
+    if(!m_screen) return;
+    m_screen->printText(0, 0, actor.getName() + "'s Inventory: (ESC to exit)", TB_YELLOW);
+    m_screen->printText(0, 1, "E) Equip item, D) Deequip item", TB_YELLOW);
     int size = actor.getInventorySize();
     int row = 2;
     if(size <= 0) {
-	m_screen.printText(2, row, "Empty", TB_CYAN);
+	m_screen->printText(2, row, "Empty", TB_CYAN);
 	return;
     }
     for(int i=0; i<size; ++i) {
 	Item* item = actor.getItemAt(i);
 	if(item == nullptr) continue;
-	m_screen.printText(0, row, " " + std::to_string(i+1) + ". " + item->getName()
+	m_screen->printText(0, row, " " + std::to_string(i+1) + ". " + item->getName()
 			   + " - Weight: " + std::to_string(item->getWeight())
 			   + ", Armor: " + std::to_string(item->getArmor()), TB_CYAN);
 	++row;
@@ -161,36 +377,38 @@ void GameBoard::showInventory(Actor &actor)
 /*Prints character sheet for an Actor, showing main stats*/
 void GameBoard::showStats(Actor &actor)
 {
-    m_screen.printText(0, 0, actor.getName() + "'s Character Sheet: (ESC to exit)", TB_YELLOW);
-    m_screen.printText(0, 1, "Health: " + std::to_string(actor.getHealth()), TB_CYAN);
-    m_screen.printText(0, 2, "Carry Weight: " + std::to_string(actor.m_carryWeight), TB_CYAN);
-    m_screen.printText(0, 3, "Carry Capacity: " + std::to_string(actor.m_maxCarryWeight), TB_CYAN);
-    m_screen.printText(0, 4, "Level: " + std::to_string(actor.m_level), TB_CYAN);
-    m_screen.printText(0, 5, "XP: " + std::to_string(actor.m_levelProgress), TB_CYAN);
-    m_screen.printText(0, 6, "Strength: " + std::to_string(actor.m_strength), TB_CYAN);
-    m_screen.printText(0, 7, "Cunning: " + std::to_string(actor.m_cunning), TB_CYAN);
-    m_screen.printText(0, 8, "Agility: " + std::to_string(actor.m_agility), TB_CYAN);
-    m_screen.printText(0, 9, "Education: " + std::to_string(actor.m_education), TB_CYAN);
-    m_screen.printText(0, 10, "Sidearm: " + std::to_string(actor.m_sidearmSkill), TB_CYAN);
-    m_screen.printText(0, 11, "Longarm: " + std::to_string(actor.m_longarmSkill), TB_CYAN);
-    m_screen.printText(0, 12, "Melee: " + std::to_string(actor.m_meleeSkill), TB_CYAN);
-    m_screen.printText(0, 13, "Barter: " + std::to_string(actor.m_barterSkill), TB_CYAN);
-    m_screen.printText(0, 14, "Negotiate: " + std::to_string(actor.m_negotiateSkill), TB_CYAN);
+    if(!m_screen) return;
+    m_screen->printText(0, 0, actor.getName() + "'s Character Sheet: (ESC to exit)", TB_YELLOW);
+    m_screen->printText(0, 1, "Health: " + std::to_string(actor.getHealth()), TB_CYAN);
+    m_screen->printText(0, 2, "Carry Weight: " + std::to_string(actor.m_carryWeight), TB_CYAN);
+    m_screen->printText(0, 3, "Carry Capacity: " + std::to_string(actor.m_maxCarryWeight), TB_CYAN);
+    m_screen->printText(0, 4, "Level: " + std::to_string(actor.m_level), TB_CYAN);
+    m_screen->printText(0, 5, "XP: " + std::to_string(actor.m_levelProgress), TB_CYAN);
+    m_screen->printText(0, 6, "Strength: " + std::to_string(actor.m_strength), TB_CYAN);
+    m_screen->printText(0, 7, "Cunning: " + std::to_string(actor.m_cunning), TB_CYAN);
+    m_screen->printText(0, 8, "Agility: " + std::to_string(actor.m_agility), TB_CYAN);
+    m_screen->printText(0, 9, "Education: " + std::to_string(actor.m_education), TB_CYAN);
+    m_screen->printText(0, 10, "Sidearm: " + std::to_string(actor.m_sidearmSkill), TB_CYAN);
+    m_screen->printText(0, 11, "Longarm: " + std::to_string(actor.m_longarmSkill), TB_CYAN);
+    m_screen->printText(0, 12, "Melee: " + std::to_string(actor.m_meleeSkill), TB_CYAN);
+    m_screen->printText(0, 13, "Barter: " + std::to_string(actor.m_barterSkill), TB_CYAN);
+    m_screen->printText(0, 14, "Negotiate: " + std::to_string(actor.m_negotiateSkill), TB_CYAN);
 }
 
 /* Show list of equipment slots, showing which items in which slots/which
    slots are empty*/
 void GameBoard::showEquipped(Actor &actor)
 {
+    if(!m_screen) return;
     std::string labels[EQUIP_MAX] = {". Head: ", ". Chest: ", ". Legs: ", ". Feet: ",
 				     ". Melee: ", ". Ranged: "};
-    m_screen.printText(0, 0, actor.getName() + "'s Equipped Items: (ESC to exit)", TB_YELLOW);
+    m_screen->printText(0, 0, actor.getName() + "'s Equipped Items: (ESC to exit)", TB_YELLOW);
     for(int i=0; i<EQUIP_MAX; ++i) {
 	Item *item = actor.getEquipped(i);
 	if(item == nullptr) {
-	    m_screen.printText(0, i+1, std::to_string(i+1) + labels[i] + "Empty", TB_CYAN);
+	    m_screen->printText(0, i+1, std::to_string(i+1) + labels[i] + "Empty", TB_CYAN);
 	} else {
-	    m_screen.printText(0, i+1, std::to_string(i+1) + labels[i] + item->getName(), TB_CYAN);
+	    m_screen->printText(0, i+1, std::to_string(i+1) + labels[i] + item->getName(), TB_CYAN);
 	}
     }
 }
@@ -199,26 +417,405 @@ void GameBoard::showEquipped(Actor &actor)
    events as they occur*/
 void GameBoard::log(const std::string &text)
 {
-    m_screen.log(text);
+    if(m_screen) {
+	m_screen->log(text);
+    } else {
+	m_messages.push_back(text);
+    }
+}
+
+/* Hands over (and forgets) messages logged since the last call; only
+   headless boards keep messages, since otherwise the screen has them*/
+std::vector<std::string> GameBoard::takeMessages()
+{
+    std::vector<std::string> messages;
+    messages.swap(m_messages);
+    return messages;
+}
+
+/* Puts the map centered on the player into the screen buffer*/
+void GameBoard::refresh()
+{
+    if(m_screen && !m_travelling) {
+	m_screen->clear();
+	m_screen->draw(m_map, m_tiles, player());
+	m_changed = false;
+    }
 }
 
 void GameBoard::redraw()
 {
+    if(!m_screen) return;
     //Redraws whole screen (useful for exiting inventory subscreen, etc.)
-    m_screen.clear();
-    m_screen.hideCursor();
-    m_screen.draw(m_map, player());
+    m_screen->clear();
+    m_screen->hideCursor();
+    m_screen->draw(m_map, m_tiles, player());
 }
 
 void GameBoard::present()
 {
-    m_screen.present();
+    if(m_screen) {
+	if(m_changed) {
+	    refresh();
+	}
+	m_screen->present();
+    }
 }
 
 /* Determines if a position is a valid one for an Actor to move into*/
 bool GameBoard::isValid(int x, int y) const
 {
-    return x < MapWidth && x >= 0 && y < MapHeight && y >= 0;
+    return x < m_map.width() && x >= 0 && y < m_map.height() && y >= 0;
+}
+
+/* Call before changing an Actor on the board: records its current state
+   for undo (the whole Actor if snapshot, e.g. for inventory changes) and
+   removes it from the board hash. Pair with endChange() once changed*/
+void GameBoard::beginChange(Actor &actor, bool snapshot)
+{
+    if(snapshot) {
+	m_history.recordActorSnapshot(indexOf(actor), actor);
+    } else {
+	m_history.recordActor(indexOf(actor), actor);
+    }
+    m_hash ^= actorKey(actor);
+}
+
+/* Adds changed Actor back into the board hash*/
+void GameBoard::endChange(const Actor &actor)
+{
+    m_hash ^= actorKey(actor);
+}
+
+/* What the coming turn plays out from besides the tiles/pieces, for the
+   undo record; taken before beginTurn() changes any of it, so a rewind
+   can put it back and begin the turn again*/
+TurnStart GameBoard::turnStart() const
+{
+    return TurnStart{m_generator, m_awake, m_wakeEvents, m_scent.save()};
+}
+
+void GameBoard::restoreTurnStart(const TurnStart &start)
+{
+    m_generator = start.generator;
+    m_awake = start.awake;
+    m_wakeEvents = start.wakeEvents;
+    m_scent.restore(start.scent);
+}
+
+/* Marks the start of a new player turn, saving its hash and starting
+   a new undo record. What the monsters perceive is worked out after that,
+   so only the entries that change get recorded*/
+void GameBoard::beginTurn()
+{
+    TurnStart start = turnStart();
+    applyReloadedTemplates();
+    updateActivity();
+    //The player's scent spreads/fades over the turn, and is freshest where they are
+    m_scent.spread();
+    m_scent.emit(player().getX(), player().getY());
+    m_turnHashes.push_back(m_hash);
+    m_history.beginTurn(m_hash, m_player_index, m_turn_index, std::move(start));
+    perceive();
+    if(m_screen) {
+	m_screen->perf().countTurn();
+    }
+}
+
+/* Re-decides which actors are awake at the start of the player's turn:
+   those within ActivityRadius of the player and able to reach them wake
+   up, and stay awake until they're past SleepRadius or cut off. Everything
+   else sleeps, so ticks cost the same however many monsters are far away*/
+void GameBoard::updateActivity()
+{
+    std::vector<int> awake;
+    auto wasAwake = m_awake.begin();
+    const Actor &you = player();
+    for(std::size_t i=0; i<m_actors.size(); ++i) {
+	const Actor &actor = m_actors[i];
+	while(wasAwake != m_awake.end() && *wasAwake < static_cast<int>(i)) {
+	    ++wasAwake;
+	}
+	int radius = wasAwake != m_awake.end() && *wasAwake == static_cast<int>(i)
+	    ? m_sleepRadius : m_activityRadius;
+	if(static_cast<int>(i) == m_player_index || static_cast<int>(i) == m_turn_index
+	   || (distanceFrom(actor.getX(), actor.getY(), you.getX(), you.getY()) <= radius
+	       && sameRegion(actor, you))) {
+	    awake.push_back(i);
+	}
+    }
+    m_awake.swap(awake);
+    while(!m_wakeEvents.empty() && m_wakeEvents.top().turn <= turn() + 1) {
+	WakeEvent event = m_wakeEvents.top();
+	m_wakeEvents.pop();
+	wakeNear(event.x, event.y, event.radius);
+    }
+}
+
+bool GameBoard::isAwake(int index) const
+{
+    return std::binary_search(m_awake.begin(), m_awake.end(), index);
+}
+
+/* Wakes the dormant actors within radius of a position (e.g. a noise)*/
+void GameBoard::wakeNear(int x, int y, int radius)
+{
+    std::vector<int> woken;
+    for(std::size_t i=0; i<m_actors.size(); ++i) {
+	const Actor &actor = m_actors[i];
+	if(distanceFrom(actor.getX(), actor.getY(), x, y) <= radius && !isAwake(i)) {
+	    woken.push_back(i);
+	}
+    }
+    if(!woken.empty()) {
+	std::vector<int> awake;
+	awake.reserve(m_awake.size() + woken.size());
+	std::merge(m_awake.begin(), m_awake.end(), woken.begin(), woken.end(),
+		   std::back_inserter(awake));
+	m_awake.swap(awake);
+    }
+}
+
+/* Wakes the actors around a position the given number of player turns
+   from now*/
+void GameBoard::scheduleWake(int x, int y, int radius, int turns)
+{
+    m_wakeEvents.push(WakeEvent{turn() + turns, x, y, radius});
+}
+
+/* Calls work(first, last) over [0, count) in chunks of the given size,
+   in parallel on the search pool if there's more than one chunk (and the
+   pool is in use); returns once all of them are done*/
+void GameBoard::forChunks(int count, int chunk, const std::function<void(int, int)> &work)
+{
+    if(m_searchThreads == 0 || count <= chunk) {
+	work(0, count);
+	return;
+    }
+    if(!m_searchPool) {
+	m_searchPool.reset(new ThreadPool(m_searchThreads));
+    }
+    for(int first=0; first<count; first+=chunk) {
+	int last = std::min(count, first + chunk);
+	m_searchPool->submit([&work, first, last] { work(first, last); });
+    }
+    m_searchPool->wait();
+}
+
+/* Changes how near the player monsters wake up and how far away they go
+   back to sleep (from the next turn on)*/
+void GameBoard::setActivityRadii(int activity, int sleep)
+{
+    m_activityRadius = activity;
+    m_sleepRadius = std::max(activity, sleep);
+}
+
+/* Works out what each awake monster perceives this turn, its target
+   included. Every monster's check is its own nearest-hostile query, but
+   only reads the board, so once there are enough of them they're split
+   into chunks of m_awake that run in parallel. The results are then
+   copied in one at a time, recording those that changed for undo*/
+void GameBoard::perceive()
+{
+    TRACE_SCOPE("GameBoard::perceive");
+    m_perception.resize(m_actors.size(), Perception{false, 0, 0, -1, -1});
+    m_perceived.resize(m_awake.size());
+    forChunks(m_awake.size(), PerceptionChunk,
+	      [this](int first, int last) { perceiveRange(first, last); });
+    for(std::size_t i=0; i<m_awake.size(); ++i) {
+	Perception &seen = m_perception[m_awake[i]];
+	if(m_awake[i] != m_player_index && !(seen == m_perceived[i])) {
+	    m_history.recordPerception(m_awake[i], seen);
+	    seen = m_perceived[i];
+	}
+    }
+}
+
+/* Works out the perception of the monsters at m_awake[first, last) into
+   m_perceived: each targets the nearest hostile in sight, if it notices
+   them; those that notice the player remember where, and the rest forget
+   once they've been there or it's been too long (hunting monsters always
+   know, see perceptionOf()). Only writes those monsters' entries*/
+void GameBoard::perceiveRange(int first, int last)
+{
+    const Actor &you = m_actors[m_player_index];
+    for(int i=first; i<last; ++i) {
+	const int index = m_awake[i];
+	if(index == m_player_index) {
+	    continue;
+	}
+	const Actor &monster = m_actors[index];
+	Perception &seen = m_perceived[i];
+	seen = m_perception[index];
+	int target = -1;
+	if(monster.isAlive()) {
+	    std::vector<int> nearest = nearestHostiles(monster, SightRadius, 1, true);
+	    if(!nearest.empty() && notices(monster, m_actors[nearest[0]], seen.target == nearest[0])) {
+		target = nearest[0];
+	    }
+	}
+	seen.target = target;
+	seen.seesPlayer = target == m_player_index;
+	if(m_hunted) {
+	    //Nothing to remember, perceptionOf() always knows where they are
+	} else if(seen.seesPlayer) {
+	    seen.lastX = you.getX();
+	    seen.lastY = you.getY();
+	    seen.lastSeen = turn();
+	} else if(turn() - seen.lastSeen > MemoryTurns
+		  || (monster.getX() == seen.lastX && monster.getY() == seen.lastY)) {
+	    seen.lastSeen = -1;
+	}
+    }
+}
+
+/* What a monster perceived at the start of this turn. A living monster
+   hunting the player knows where they are, without that being copied
+   into (and recorded for) every monster each turn*/
+Perception GameBoard::perceptionOf(const Actor &monster) const
+{
+    Perception seen = m_perception[indexOf(monster)];
+    if(m_hunted && monster.isAlive()) {
+	seen.lastX = m_actors[m_player_index].getX();
+	seen.lastY = m_actors[m_player_index].getY();
+	seen.lastSeen = turn();
+    }
+    return seen;
+}
+
+/* Whether a monster notices a hostile in its sight (see nearestHostiles()):
+   they have to be near enough not to sneak past it. The more agile they
+   are than the monster is cunning, the nearer they can get (down to
+   MinNoticeRadius); once noticed, they're kept track of as long as
+   they're in sight*/
+bool GameBoard::notices(const Actor &monster, const Actor &target, bool noticed) const
+{
+    int radius = SightRadius;
+    if(!noticed) {
+	int stealth = std::max(0, target.m_agility - monster.m_cunning) / 2;
+	radius = std::max(MinNoticeRadius, SightRadius - stealth);
+    }
+    return distanceFrom(monster.getX(), monster.getY(), target.getX(), target.getY()) <= radius;
+}
+
+/* Starts reloading the templates whenever either file changes; the new
+   tables are swapped in at the start of the player's next turn, and with
+   updateLive, existing monsters take on their template's new stats too*/
+void GameBoard::watchTemplates(const std::string &monstersFile, const std::string &itemsFile,
+			       bool updateLive)
+{
+    m_updateLiveTemplates = updateLive;
+    m_templateWatcher.reset(new TemplateWatcher(monstersFile, itemsFile));
+}
+
+/* Swaps in templates the watcher has finished parsing, if any. A reload
+   with errors is reported and otherwise ignored, so a half-edited file
+   never takes effect*/
+void GameBoard::applyReloadedTemplates()
+{
+    if(!m_templateWatcher) {
+	return;
+    }
+    std::unique_ptr<TemplateSet> templates = m_templateWatcher->take();
+    if(!templates) {
+	return;
+    }
+    if(!templates->errors.empty()) {
+	for(const std::string &error : templates->errors) {
+	    log(error);
+	}
+	log("Template reload failed; keeping the old templates");
+	return;
+    }
+    m_tiles.build(templates->monsters, templates->items);
+    if(m_updateLiveTemplates) {
+	for(Actor &actor : m_actors) {
+	    const Actor *temp = m_tiles.monster(actor.getCh());
+	    if(actor.isPlayer() || !temp) {
+		continue;
+	    }
+	    beginChange(actor, true);
+	    actor.applyTemplate(*temp);
+	    endChange(actor);
+	}
+    }
+    log("Reloaded templates");
+}
+
+/* Changes the character in one layer of a map cell, keeping the board
+   hash in sync. Only terrain is hashed; the other layers just mirror where
+   the (already hashed) Actors/Items are*/
+void GameBoard::setTile(MapLayer layer, int x, int y, char ch)
+{
+    LevelMap &tiles = m_map.layer(layer);
+    m_history.recordTile(layer, x, y, tiles[y][x]);
+    if(layer == MapLayer::TERRAIN) {
+	m_hash ^= tileKey(x, y, tiles[y][x]) ^ tileKey(x, y, ch);
+	m_walls.set(x, y, ch != 0);
+	m_scent.setWall(x, y, ch != 0);
+	//A new wall might cut a region in two; an opening only joins them
+	if(ch != 0 && tiles[y][x] == 0) {
+	    m_regions.relabel(m_walls);
+	} else if(ch == 0 && tiles[y][x] != 0) {
+	    m_regions.opened(x, y);
+	}
+    } else if(layer == MapLayer::ACTORS) {
+	m_occupied.set(x, y, ch != 0);
+    }
+    tiles[y][x] = ch;
+}
+
+/* Recreates the bitboards (and the regions found from them) from the
+   layers after they're replaced wholesale (loading a map, undoing turns)*/
+void GameBoard::rebuildBitboards()
+{
+    m_walls = Bitboard::fromLayer(m_map.terrain());
+    m_occupied = Bitboard::fromLayer(m_map.actors());
+    m_regions.relabel(m_walls);
+    m_scent.reset(m_walls);
+    m_actorGrid.assign(m_map.width() * m_map.height(), -1);
+    for(Bitboard &cells : m_factionCells) {
+	cells = Bitboard(m_map.width(), m_map.height());
+    }
+    for(std::size_t i=0; i<m_actors.size(); ++i) {
+	const Actor &actor = m_actors[i];
+	if(actor.isAlive()) {
+	    m_actorGrid[actor.getY() * m_map.width() + actor.getX()] = i;
+	    factionCells(actor).set(actor.getX(), actor.getY());
+	}
+    }
+}
+
+/* Warns about monsters on a newly loaded map that are walled off from the
+   player (they'll never move)*/
+void GameBoard::checkReachable()
+{
+    int sealedOff = 0;
+    for(const Actor &actor : m_actors) {
+	sealedOff += !actor.isPlayer() && !sameRegion(actor, player());
+    }
+    if(sealedOff > 0) {
+	log("Warning: " + std::to_string(sealedOff) + " monsters can't reach the player");
+    }
+}
+
+/* Hashes the whole board from scratch; m_hash should always equal this,
+   so it's only needed after loading a map or to check the incremental hash*/
+std::uint64_t GameBoard::computeHash() const
+{
+    std::uint64_t hash = 0;
+    for(int row=0; row<m_map.height(); ++row) {
+	for(int col=0; col<m_map.width(); ++col) {
+	    hash ^= tileKey(col, row, m_map.terrain()[row][col]);
+	}
+    }
+    for(const Actor &actor : m_actors) {
+	hash ^= actorKey(actor);
+    }
+    for(const Item &item : m_items) {
+	hash ^= itemKey(item);
+    }
+    return hash;
 }
 
 /* Removes given Item from m_items*/
@@ -230,6 +827,8 @@ void GameBoard::deleteItem(int x, int y)
 
     for(unsigned int i=0; i<m_items.size(); ++i) {
 	if(m_items[i].getX() == x && m_items[i].getY() == y) {
+	    m_history.recordItemErased(i, m_items[i]);
+	    m_hash ^= itemKey(m_items[i]);
 	    m_items.erase(m_items.begin()+i);
 	    return;
 	}
@@ -240,59 +839,158 @@ void GameBoard::deleteItem(int x, int y)
 /* Removes given Actor from m_actors*/
 void GameBoard::deleteActor(int x, int y)
 {
-    if(m_actors.size() <= 0) {
+    int pos = actorIndexAt(x, y);
+    if(pos < 0) {
+	log("Error: actor not found");
 	return;
     }
-    using vector_t = std::vector<Actor>::size_type;
-
-    bool foundActor = false;
-    int pos = 0;
-    for(vector_t i=0; i<m_actors.size(); ++i) {
-	if(m_actors[i].getX() == x && m_actors[i].getY() == y) {
-	    log(m_actors[i].getName() + " died");
-	    m_actors.erase(m_actors.begin()+i);
-	    foundActor = true;
-	    pos = i;
-	    break;
+    log(m_actors[pos].getName() + " died");
+    m_actorGrid[y * m_map.width() + x] = -1;
+    factionCells(m_actors[pos]).set(x, y, false);
+    //Player stays in m_actors (dead) so player() stays valid; game is over
+    if(pos == m_player_index) {
+	log("Player is dead");
+	return;
+    }
+    //Monsters targeting it lose their target (recorded first, so an undo
+    //gives it back once the actor is back in its place)
+    for(std::size_t i=0; i<m_perception.size(); ++i) {
+	if(m_perception[i].target == pos) {
+	    m_history.recordPerception(i, m_perception[i]);
+	    m_perception[i].target = -1;
 	}
     }
-    if(!foundActor) {
-	log("Error: actor not found");
-	return;
+    m_history.recordActorErased(pos, m_actors[pos]);
+    m_hash ^= actorKey(m_actors[pos]);
+    m_actors.erase(m_actors.begin() + pos);
+    if(pos < static_cast<int>(m_perception.size())) {
+	m_history.recordPerceptionErased(pos, m_perception[pos]);
+	m_perception.erase(m_perception.begin() + pos);
     }
-    //Need to update player/turn indexes to account for deletion
+    for(Perception &seen : m_perception) {
+	if(seen.target > pos) {
+	    --seen.target;
+	}
+    }
+    //Actors after it have moved down one place
+    for(std::size_t i=pos; i<m_actors.size(); ++i) {
+	if(m_actors[i].isAlive()) {
+	    --m_actorGrid[m_actors[i].getY() * m_map.width() + m_actors[i].getX()];
+	}
+    }
+    //Need to update player/turn/awake indexes to account for deletion
     if(pos < m_player_index) {
 	--m_player_index;
-    } else if(pos == m_player_index) {
-	log("Player is dead/deleted");
     }
-
-    if(static_cast<vector_t>(m_turn_index) >= m_actors.size()) {
+    if(pos < m_turn_index) {
+	--m_turn_index;
+    }
+    if(m_turn_index >= static_cast<int>(m_actors.size())) {
 	m_turn_index = 0;
     }
+    for(int &planned : m_planned) {
+	if(planned == pos) {
+	    planned = -1;
+	} else if(planned > pos) {
+	    --planned;
+	}
+    }
+    auto deleted = std::lower_bound(m_awake.begin(), m_awake.end(), pos);
+    if(deleted != m_awake.end() && *deleted == pos) {
+	deleted = m_awake.erase(deleted);
+    }
+    for(; deleted != m_awake.end(); ++deleted) {
+	--*deleted;
+    }
 }
 
-/* Equips item in inventory into an Actor's equip slots*/
+/* Asks which inventory item to equip into which of an Actor's equip slots*/
 void GameBoard::equipItem(Actor &actor)
 {
-    int index = m_screen.input("Enter item #: ") - 1;
-    int pos = m_screen.input("Enter equip position [1-"
-			     + std::to_string(EQUIP_MAX) + "]: ", 0, 1) - 1;
-    actor.equipItem(index, pos);
+    if(!m_screen) return;
+    int index = m_screen->input("Enter item #: ") - 1;
+    int pos = m_screen->input("Enter equip position [1-"
+			      + std::to_string(EQUIP_MAX) + "]: ", 0, 1) - 1;
+    equipItem(actor, index, pos);
+    refresh();
+}
+
+/* Equips item in inventory into an Actor's equip slots*/
+bool GameBoard::equipItem(Actor &actor, int index, int position)
+{
+    if(index < 0 || index >= actor.getInventorySize()
+       || position < 0 || position >= EQUIP_MAX) {
+	return false;
+    }
+    beginChange(actor, true);
+    actor.equipItem(index, position);
+    endChange(actor);
+    return true;
+}
 
-    m_screen.clear();
-    m_screen.draw(m_map, player());
+/* Asks which of an Actor's equip slots to empty*/
+void GameBoard::deequipItem(Actor &actor)
+{
+    if(!m_screen) return;
+    int pos = m_screen->input("Enter equip position [1-"
+			      + std::to_string(EQUIP_MAX) + "]: ", 0, 1) - 1;
+    deequipItem(actor, pos);
+    refresh();
 }
 
 /* Deequips item from Actor's armor slot*/
-void GameBoard::deequipItem(Actor &actor)
+bool GameBoard::deequipItem(Actor &actor, int position)
 {
-    int pos = m_screen.input("Enter equip position [1-"
-			     + std::to_string(EQUIP_MAX) + "]: ", 0, 1) - 1;
-    actor.deequipItem(pos);
+    if(actor.getEquipped(position) == nullptr) {
+	return false;
+    }
+    beginChange(actor, true);
+    actor.deequipItem(position);
+    endChange(actor);
+    return true;
+}
 
-    m_screen.clear();
-    m_screen.draw(m_map, player());
+/* Ends an Actor's turn early, giving up its remaining energy*/
+void GameBoard::endTurn(Actor &actor)
+{
+    beginChange(actor);
+    actor.setTurn(actor.isTurn(), 0);
+    endChange(actor);
+}
+
+/* Returns the board to how it was at the start of the player's turn from
+   the given number of turns ago (0 being the start of the current turn)*/
+bool GameBoard::rewind(int turns)
+{
+    if(turns < 0 || turns >= m_history.size()) {
+	return false;
+    }
+    TurnRecord turn = m_history.undoTurn(m_map, m_actors, m_items, m_perception);
+    for(int i=0; i<turns; ++i) {
+	turn = m_history.undoTurn(m_map, m_actors, m_items, m_perception);
+    }
+    rebuildBitboards();
+    m_hash = turn.hash;
+    m_player_index = turn.playerIndex;
+    m_turn_index = turn.turnIndex;
+    restoreTurnStart(turn.start);
+    //The restored turn gets re-recorded as it is replayed
+    m_turnHashes.resize(m_turnHashes.size() - turns - 1);
+    beginTurn();
+    log("Rewound " + std::to_string(turns) + " turns");
+    return true;
+}
+
+/* Asks how many turns to undo, then rewinds the board*/
+void GameBoard::rewindTurns()
+{
+    if(!m_screen) return;
+    int turns = m_screen->input("Turns to rewind [0-"
+				+ std::to_string(m_history.size() - 1) + "]: ");
+    if(!rewind(turns)) {
+	log("Can't rewind that far");
+    }
+    redraw();
 }
 
 /* Moves actor from current position to another, redrawing screen
@@ -303,12 +1001,20 @@ bool GameBoard::changePos(Actor &actor, int newX, int newY)
     //Note: screen doesn't visibly change until screen.present() called in main loop
     int oldX = actor.getX();
     int oldY = actor.getY();
+    beginChange(actor);
     actor.move(newX, newY);
-    m_map[oldY][oldX] = 0;
-    m_map[newY][newX] = actor.getCh();
+    endChange(actor);
+    setTile(MapLayer::ACTORS, oldX, oldY, 0);
+    setTile(MapLayer::ACTORS, newX, newY, actor.getCh());
+    m_actorGrid[oldY * m_map.width() + oldX] = -1;
+    m_actorGrid[newY * m_map.width() + newX] = indexOf(actor);
+    factionCells(actor).set(oldX, oldY, false);
+    factionCells(actor).set(newX, newY);
+    if(indexOf(actor) == m_player_index) {
+	markSeen();
+    }
 
-    m_screen.clear();
-    m_screen.draw(m_map, player());
+    markChanged();
     return true;
 }
 
@@ -320,14 +1026,18 @@ bool GameBoard::pickupItem(Actor &actor, int x, int y)
 	//Find existing Item at the given position
 	if(each.getX() == x && each.getY() == y) {
 	    if(actor.canCarry(each.getWeight())) {
+		std::string name = each.getName();
+		beginChange(actor, true);
 		actor.addItem(each);
+		endChange(actor);
 		//Item now in Actor inventory, not on map, so stop tracking
 		deleteItem(x, y);
-		m_map[y][x] = 0;
-		log(actor.getName() + " picked up " + each.getName());
+		if(!hasItemAt(x, y)) {
+		    setTile(MapLayer::ITEMS, x, y, 0);
+		}
+		log(actor.getName() + " picked up " + name);
 
-		m_screen.clear();
-		m_screen.draw(m_map, player());
+		markChanged();
 	    }
 	    return true;
 	}
@@ -336,60 +1046,86 @@ bool GameBoard::pickupItem(Actor &actor, int x, int y)
     return false;
 }
 
+/* Checks if any Item is still lying at the given position*/
+bool GameBoard::hasItemAt(int x, int y) const
+{
+    for(const Item &each : m_items) {
+	if(each.getX() == x && each.getY() == y) {
+	    return true;
+	}
+    }
+    return false;
+}
+
 /* Have given Actor attack an Actor at another position. If no Actor
    at that position, do nothing; private function, only to be called
    by moveActor()*/
 bool GameBoard::melee(Actor &attacker, int targetX, int targetY)
 {
-    for(Actor &each : m_actors) {
-	if(each.getX() == targetX && each.getY() == targetY
-	   && each.getFaction() != attacker.getFaction()) {
-	    //Attacker attempts to attack; print result (success/fail)
-	    int eachHealth = each.getHealth();
-	    int attackerHealth = attacker.getHealth();
-	    if(attacker.attack(each)) {
-		log(attacker.getName() + " attacked " + each.getName());
-		log("Damage: " + std::to_string(each.getHealth() - eachHealth));
-	    } else {
-		log(each.getName() + " attacked " + attacker.getName());
-		log("Damage: " + std::to_string(attacker.getHealth() - attackerHealth));
-	    }
-
-	    if(!each.isAlive()) {
-		m_map[targetY][targetX] = 0;
-		deleteActor(targetX, targetY);
-	    }
+    int index = actorIndexAt(targetX, targetY);
+    if(index < 0 || !m_actors[index].isAlive()
+       || m_actors[index].getFaction() == attacker.getFaction()) {
+	return false;
+    }
+    Actor &each = m_actors[index];
+    //Attacker attempts to attack; print result (success/fail)
+    int eachHealth = each.getHealth();
+    int attackerHealth = attacker.getHealth();
+    beginChange(attacker);
+    beginChange(each);
+    bool attackerWon = attacker.attack(each, m_generator);
+    endChange(attacker);
+    endChange(each);
+    if(attackerWon) {
+	log(attacker.getName() + " attacked " + each.getName());
+	log("Damage: " + std::to_string(each.getHealth() - eachHealth));
+    } else {
+	log(each.getName() + " attacked " + attacker.getName());
+	log("Damage: " + std::to_string(attacker.getHealth() - attackerHealth));
+    }
+    //The noise of a fight wakes monsters nearby
+    wakeNear(targetX, targetY, NoiseRadius);
 
-	    m_screen.clear();
-	    m_screen.draw(m_map, player());
-	    return true;
-	}
+    if(!each.isAlive()) {
+	setTile(MapLayer::ACTORS, targetX, targetY, 0);
+	deleteActor(targetX, targetY);
     }
-    return false;
+
+    markChanged();
+    return true;
 }
 
-/* Performs action on given position; will move Actor there if possible,
-   pickup an Item at that position, or attack a Monster at that position*/
+/* Performs action on given position; will move Actor there if possible
+   (picking up any Item lying there), or attack a Monster at that position*/
 bool GameBoard::moveActor(Actor &actor, int newX, int newY)
 {
     //Check to make sure turn is respected/position exists/is within teleport range
     //and not attacking self
-    if(!actor.isTurn() || !isValid(newX, newY)
+    if(!actor.isTurn() || !actor.isAlive() || !isValid(newX, newY)
        || distanceFrom(actor.getX(), actor.getY(), newX, newY) >= 5
        || (actor.getX() == newX && actor.getY() == newY)) {
 	return false;
     }
-    //If tile is empty, move Actor to it
-    if(m_map[newY][newX] == 0) {
-	return changePos(actor, newX, newY);
+    //Teleports can't pass through walls
+    if((std::abs(newX - actor.getX()) > 1 || std::abs(newY - actor.getY()) > 1)
+       && m_walls.lineBlocked(actor.getX(), actor.getY(), newX, newY)) {
+	return false;
     }
-    //If an Item is in that position, try to pick it up
-    else if(m_map[newY][newX] == ItemTile) {
-	return pickupItem(actor, newX, newY);
-    } else if(m_map[newY][newX] != WallTile) {
+    //If another Actor is there, attack it
+    if(m_map.actors()[newY][newX] != 0) {
 	return melee(actor, newX, newY);
     }
-    return false;
+    if(m_map.terrain()[newY][newX] != 0) {
+	return false;
+    }
+    if(!changePos(actor, newX, newY)) {
+	return false;
+    }
+    //Items lying there are picked up on the way in (if they can be carried)
+    if(m_map.items()[newY][newX] != 0) {
+	pickupItem(actor, newX, newY);
+    }
+    return true;
 }
 
 /* Attacks another player over a distance using a ranged weapon if equipped
@@ -397,41 +1133,57 @@ bool GameBoard::moveActor(Actor &actor, int newX, int newY)
    if no item equipped at all)*/
 bool GameBoard::rangeAttack(Actor& attacker, int targetX, int targetY)
 {
-    //Can't attack yourself
-    if(attacker.getX() == targetX && attacker.getY() == targetY) {
+    //Can't attack yourself, or shoot off the map
+    if((attacker.getX() == targetX && attacker.getY() == targetY) || !isValid(targetX, targetY)) {
+	return false;
+    }
+    //Walls stop shots, and the first Actor in the way takes the hit
+    LineOfFire line = traceFire(attacker.getX(), attacker.getY(), targetX, targetY);
+    if(line.hit == LineHit::WALL) {
+	log("No clear shot");
+	return false;
+    }
+    if(line.hit == LineHit::OFF_MAP) {
 	return false;
     }
+    targetX = line.x;
+    targetY = line.y;
 
-    for(Actor &each : m_actors) {
-	if(each.getX() == targetX && each.getY() == targetY) {
-	    //Figure out whether to throw/fire projectile
-	    Item *weapon = attacker.getEquipped(RANGE_WEAPON);
-	    if(weapon == nullptr) {
-		log("No ranged weapon to use");
-		return false;
-	    }
-	    if(weapon->isRanged()) {
-		//Fire projectile
-		//Attacker attempts to attack; print result (success/fail)
-		if(attacker.attack(each))
-		    log(attacker.getName() + " range attacked " + each.getName());
-		else
-		    log(each.getName() + " range attacked " + attacker.getName());
-	    } else {
-		//Throw item
-		log("Item thrown");
-	    }
+    int index = actorIndexAt(targetX, targetY);
+    if(index < 0 || !m_actors[index].isAlive()) {
+	return false;
+    }
+    Actor &each = m_actors[index];
+    //Figure out whether to throw/fire projectile
+    Item *weapon = attacker.getEquipped(RANGE_WEAPON);
+    if(weapon == nullptr) {
+	log("No ranged weapon to use");
+	return false;
+    }
+    if(weapon->isRanged()) {
+	//Fire projectile
+	//Attacker attempts to attack; print result (success/fail)
+	beginChange(attacker);
+	beginChange(each);
+	bool attackerWon = attacker.attack(each, m_generator);
+	endChange(attacker);
+	endChange(each);
+	if(attackerWon)
+	    log(attacker.getName() + " range attacked " + each.getName());
+	else
+	    log(each.getName() + " range attacked " + attacker.getName());
+	wakeNear(targetX, targetY, NoiseRadius);
+    } else {
+	//Throw item
+	log("Item thrown");
+    }
 
-	    if(!each.isAlive()) {
-		m_map[targetY][targetX] = 0;
-		deleteActor(targetX, targetY);
-	    }
-	    m_screen.clear();
-	    m_screen.draw(m_map, player());
-	    return true;
-	}
+    if(!each.isAlive()) {
+	setTile(MapLayer::ACTORS, targetX, targetY, 0);
+	deleteActor(targetX, targetY);
     }
-    return false;
+    refresh();
+    return true;
 }
 
 bool GameBoard::translateActor(Actor &actor, int dx, int dy)
@@ -439,6 +1191,73 @@ bool GameBoard::translateActor(Actor &actor, int dx, int dy)
     return moveActor(actor, actor.getX() + dx, actor.getY() + dy);
 }
 
+/* Has an elite monster near the player pick its next step by searching
+   simulated fights; returns false if it didn't move (e.g. player too far
+   away to be worth searching, or the turn's search time is used up),
+   leaving the normal AI to decide. Timed searches split what's left of
+   the turn's LookaheadBudgetMs evenly among the searches still to come,
+   so a turn takes about as long however many elites are awake*/
+bool GameBoard::lookaheadStep(Actor &actor)
+{
+    Actor &target = player();
+    const int searches = std::max(1, m_searchesLeft);
+    m_searchesLeft = std::max(0, m_searchesLeft - 1);
+    const SearchClock::duration left = m_lookaheadDeadline - SearchClock::now();
+    if(distanceFrom(actor.getX(), actor.getY(), target.getX(), target.getY())
+       > LookaheadRadius || (m_lookaheadRollouts == 0 && left <= SearchClock::duration::zero())) {
+	return false;
+    }
+    //Only copy the part of the map the fight could reach
+    SearchState state;
+    state.originX = std::max(0, actor.getX() - LookaheadWindow);
+    state.originY = std::max(0, actor.getY() - LookaheadWindow);
+    state.width = std::min(m_map.width(), actor.getX() + LookaheadWindow + 1) - state.originX;
+    state.height = std::min(m_map.height(), actor.getY() + LookaheadWindow + 1) - state.originY;
+    state.blocked.resize(state.width * state.height);
+    for(int row=0; row<state.height; ++row) {
+	for(int col=0; col<state.width; ++col) {
+	    state.blocked[row * state.width + col]
+		= !isOpen(state.originX + col, state.originY + row);
+	}
+    }
+    state.blocked[(actor.getY() - state.originY) * state.width
+		  + actor.getX() - state.originX] = false;
+    state.blocked[(target.getY() - state.originY) * state.width
+		  + target.getX() - state.originX] = false;
+    state.monster = Combatant{actor.getX(), actor.getY(), actor.getHealth(),
+			      actor.getEnergy(), actor.combatStats()};
+    state.player = Combatant{target.getX(), target.getY(), target.getHealth(),
+			     TurnEnergy, target.combatStats()};
+
+    if(!m_searchPool && m_searchThreads > 0) {
+	m_searchPool.reset(new ThreadPool(m_searchThreads));
+    }
+    int dx = 0;
+    int dy = 0;
+    return chooseLookaheadMove(state, m_searchPool.get(), m_generator, dx, dy, m_lookaheadRollouts,
+			       left / searches)
+	&& translateActor(actor, dx, dy);
+}
+
+/* Carries out a monster's planned step against the board as it is now.
+   Another monster may have taken the cell since it planned (monsters don't
+   attack each other); then, as when it's blocked anyway, it tries just the
+   vertical, then just the horizontal part of the step. Its turn ends if
+   it has nothing to do or can't move at all*/
+void GameBoard::commitPlan(Actor &monster, const MovePlan &plan)
+{
+    if(!plan.wait) {
+	if(plan.lookahead && lookaheadStep(monster)) {
+	    return;
+	}
+	if(translateActor(monster, plan.dx, plan.dy) || translateActor(monster, 0, plan.dy)
+	   || translateActor(monster, plan.dx, 0)) {
+	    return;
+	}
+    }
+    monster.setTurn(false, monster.getEnergy());
+}
+
 /* If possible, moves the player into a new location, updating the player
    object, map array, screen buffer, and display to show the change*/
 void GameBoard::movePlayer(int newX, int newY)
@@ -449,9 +1268,285 @@ void GameBoard::movePlayer(int newX, int newY)
 /* Shortcut for moving player through change in current position*/
 void GameBoard::translatePlayer(int dx, int dy)
 {
-    if(!m_screen.hasCursor()) {
+    if(!m_screen || !m_screen->hasCursor()) {
 	translateActor(player(), dx, dy);
     } else {
-	m_screen.translateCursor(dx, dy);
+	m_screen->translateCursor(dx, dy);
+	showLineOfFire();
+    }
+}
+
+/* Whether the player can see a cell: within SightRadius, with no wall in
+   between*/
+bool GameBoard::canSee(int x, int y) const
+{
+    const Actor &you = m_actors[m_player_index];
+    return distanceFrom(x, y, you.getX(), you.getY()) <= SightRadius
+	&& !m_walls.lineBlocked(you.getX(), you.getY(), x, y);
+}
+
+/* Marks the cells the player can see from where they are as explored*/
+void GameBoard::markSeen()
+{
+    const Actor &you = player();
+    int endX = std::min(m_map.width(), you.getX() + SightRadius + 1);
+    int endY = std::min(m_map.height(), you.getY() + SightRadius + 1);
+    for(int y=std::max(0, you.getY() - SightRadius); y<endY; ++y) {
+	for(int x=std::max(0, you.getX() - SightRadius); x<endX; ++x) {
+	    if(!m_explored.test(x, y) && canSee(x, y)) {
+		m_explored.set(x, y);
+	    }
+	}
+    }
+}
+
+/* Returns a living monster the player can see, or nullptr if there's none;
+   dormant monsters are too far away to see, so only awake ones are checked*/
+const Actor* GameBoard::monsterInView()
+{
+    for(int index : m_awake) {
+	const Actor &actor = m_actors[index];
+	if(index != m_player_index && actor.isAlive() && canSee(actor.getX(), actor.getY())) {
+	    return &actor;
+	}
     }
+    return nullptr;
 }
+
+/* Runs game ticks until it is the player's turn again (or player died)*/
+void GameBoard::finishPlayerTurn()
+{
+    int ticks = 0;
+    updateActors();
+    while(player().isAlive() && ticks < MaxTicksPerTurn
+	  && !(player().isTurn() && player().getEnergy() > 0)) {
+	updateActors();
+	++ticks;
+    }
+}
+
+/* Walks the player towards the nearest cell isGoal accepts a step at a
+   time, the monsters taking their turns whenever the player's energy runs
+   out. Re-plans once the planned-for cell is reached or no longer a goal
+   (or something steps into the way). Stops when there's nowhere left to
+   go, the player dies, or a monster comes into view. The screen is drawn
+   at most every TravelFrameMs instead of after every move. Returns the
+   number of steps taken*/
+int GameBoard::travel(const std::function<bool(int, int)> &isGoal)
+{
+    TRACE_SCOPE("GameBoard::travel");
+    m_travelling = true;
+    PerfClock::time_point lastFrame = PerfClock::now();
+    std::vector<PathStep> path;
+    std::size_t next = 0;
+    int steps = 0;
+    while(steps < MaxTravelSteps) {
+	if(next == path.size() || !isGoal(path.back().x, path.back().y)) {
+	    Bitboard blocked = m_walls;
+	    blocked |= m_occupied;
+	    path = findPath(blocked, player().getX(), player().getY(), isGoal);
+	    next = 0;
+	    if(path.empty()) {
+		break;
+	    }
+	}
+	const PathStep &step = path[next++];
+	if(!isOpen(step.x, step.y)) {
+	    path.clear();
+	    next = 0;
+	    continue;
+	}
+	if(!moveActor(player(), step.x, step.y)) {
+	    break;
+	}
+	++steps;
+	finishPlayerTurn();
+	if(!player().isAlive()) {
+	    break;
+	}
+	if(const Actor *monster = monsterInView()) {
+	    log(monster->getName() + " comes into view");
+	    break;
+	}
+	if(m_screen && PerfClock::now() - lastFrame >= std::chrono::milliseconds(TravelFrameMs)) {
+	    lastFrame = PerfClock::now();
+	    m_screen->clear();
+	    m_screen->draw(m_map, m_tiles, player());
+	    m_screen->present();
+	}
+    }
+    m_travelling = false;
+    refresh();
+    return steps;
+}
+
+/* Travels the player to a cell (e.g. the cursor's) over as many turns as
+   it takes; not while a monster is in view*/
+bool GameBoard::travelTo(Actor &actor, int x, int y)
+{
+    if(indexOf(actor) != m_player_index || !actor.isTurn()) {
+	return false;
+    }
+    if(const Actor *monster = monsterInView()) {
+	log("Can't travel with " + monster->getName() + " in view");
+	return false;
+    }
+    if(travel([x, y](int cellX, int cellY) { return cellX == x && cellY == y; }) == 0) {
+	log("No way to get there");
+	return false;
+    }
+    return true;
+}
+
+/* Travels towards the nearest cells the player hasn't seen yet until
+   there are none they can reach (or a monster comes into view)*/
+bool GameBoard::autoExplore()
+{
+    if(!player().isTurn()) {
+	return false;
+    }
+    if(const Actor *monster = monsterInView()) {
+	log("Can't explore with " + monster->getName() + " in view");
+	return false;
+    }
+    if(travel([this](int x, int y) { return !m_explored.test(x, y); }) == 0) {
+	log("Nothing left to explore");
+	return false;
+    }
+    return true;
+}
+
+/* Follows the ray from one cell to another until it hits a wall or an
+   Actor (the end cell included) or leaves the map, optionally collecting
+   the cells it passes through (the one it stops at included). Never
+   returns a cell off the map*/
+LineOfFire GameBoard::traceFire(int fromX, int fromY, int toX, int toY,
+				std::vector<PathStep> *cells) const
+{
+    int lastX = fromX, lastY = fromY;
+    for(const RayStep &step : Ray(toX - fromX, toY - fromY)) {
+	int x = fromX + step.dx, y = fromY + step.dy;
+	if(!isValid(x, y)) {
+	    return LineOfFire{LineHit::OFF_MAP, lastX, lastY};
+	}
+	lastX = x;
+	lastY = y;
+	if(cells) {
+	    cells->push_back(PathStep{x, y});
+	}
+	if(m_walls.test(x, y)) {
+	    return LineOfFire{LineHit::WALL, x, y};
+	}
+	if(m_occupied.test(x, y)) {
+	    return LineOfFire{LineHit::ACTOR, x, y};
+	}
+    }
+    //Rays too long to hold have no steps, and always end off the map
+    if(!isValid(toX, toY)) {
+	return LineOfFire{LineHit::OFF_MAP, lastX, lastY};
+    }
+    return LineOfFire{LineHit::NOTHING, toX, toY};
+}
+
+/* Highlights the line from the player to the cursor while aiming a ranged
+   attack or teleport: where it's clear, and where it's stopped*/
+void GameBoard::showLineOfFire()
+{
+    if(!m_screen || !m_screen->hasCursor()
+       || (m_cursorAction != &GameBoard::rangeAttack && m_cursorAction != &GameBoard::moveActor)) {
+	return;
+    }
+    refresh();
+    std::vector<PathStep> cells;
+    const Actor &you = player();
+    LineOfFire line = traceFire(you.getX(), you.getY(), m_screen->getCursorX(),
+				m_screen->getCursorY(), &cells);
+    for(const PathStep &cell : cells) {
+	bool stop = cell.x == line.x && cell.y == line.y && line.hit != LineHit::NOTHING;
+	m_screen->highlight(cell.x, cell.y, m_tiles[m_map.top(cell.x, cell.y)].glyph,
+			    TB_WHITE, stop ? TB_RED : TB_BLUE);
+    }
+}
+
+/* Finds up to count Actors in the given cells (m_occupied, or one of its
+   subsets) that accept() takes within radius of a cell, nearest first
+   (ties in row order). Only the part of the cells around the cell is
+   looked at, a word (64 cells) at a time, so the cost depends on how
+   crowded the area is rather than on how many Actors there are*/
+std::vector<int> GameBoard::nearestActorsIn(const Bitboard &cells, int x, int y, int radius,
+					    int count,
+					    const std::function<bool(const Actor&)> &accept) const
+{
+    std::vector<std::pair<int, int>> found; //Squared distance, index
+    //Same as distanceFrom() <= radius, without the square root
+    const int outside = (radius + 1) * (radius + 1);
+    cells.forEachSet(std::max(0, x - radius), std::max(0, y - radius),
+		     std::min(m_map.width() - 1, x + radius),
+		     std::min(m_map.height() - 1, y + radius),
+		     [&](int col, int row) {
+			 int distance = (col-x)*(col-x) + (row-y)*(row-y);
+			 int index = m_actorGrid[row * m_map.width() + col];
+			 if(distance < outside && index >= 0 && accept(m_actors[index])) {
+			     found.emplace_back(distance, index);
+			 }
+		     });
+    std::size_t kept = std::min(found.size(), static_cast<std::size_t>(count));
+    std::partial_sort(found.begin(), found.begin() + kept, found.end());
+    std::vector<int> nearest;
+    for(std::size_t i=0; i<kept; ++i) {
+	nearest.push_back(found[i].second);
+    }
+    return nearest;
+}
+
+/* Finds up to count living Actors of another faction within radius of the
+   viewer, nearest first; with visibleOnly, just those with no wall between.
+   With two factions, only the other one's cells need looking at*/
+std::vector<int> GameBoard::nearestHostiles(const Actor &viewer, int radius, int count,
+					    bool visibleOnly) const
+{
+    static_assert(FactionCount == 2, "Hostiles are looked for in one other faction's cells");
+    const Bitboard &hostile = m_factionCells[viewer.getFaction() == Faction::PLAYER
+					     ? static_cast<int>(Faction::MONSTER)
+					     : static_cast<int>(Faction::PLAYER)];
+    return nearestActorsIn(hostile, viewer.getX(), viewer.getY(), radius, count,
+			   [this, &viewer, visibleOnly](const Actor &actor) {
+			       return actor.isAlive() && actor.getFaction() != viewer.getFaction()
+				   && (!visibleOnly || !m_walls.lineBlocked(viewer.getX(), viewer.getY(),
+									    actor.getX(), actor.getY()));
+			   });
+}
+
+/* Who a monster goes after: the nearest hostile it noticed at the start
+   of the turn, else nullptr (it has to remember or smell its way)*/
+const Actor* GameBoard::targetFor(const Actor &monster) const
+{
+    int target = perceptionOf(monster).target;
+    return target >= 0 ? &m_actors[target] : nullptr;
+}
+
+/* Jumps the cursor to the nearest hostile the player can see (showing the
+   cursor to aim a ranged attack first, if it isn't shown); with the cursor
+   already on one of them, moves on to the next nearest*/
+void GameBoard::cycleTarget()
+{
+    if(!m_screen) return;
+    std::vector<int> targets = nearestHostiles(player(), SightRadius, MaxTargets, true);
+    if(targets.empty()) {
+	log("No targets in view");
+	return;
+    }
+    if(!m_screen->hasCursor()) {
+	bindCursorMode(player(), &GameBoard::rangeAttack);
+    }
+    std::size_t next = 0;
+    for(std::size_t i=0; i<targets.size(); ++i) {
+	const Actor &target = m_actors[targets[i]];
+	if(target.getX() == m_screen->getCursorX() && target.getY() == m_screen->getCursorY()) {
+	    next = (i + 1) % targets.size();
+	}
+    }
+    m_screen->moveCursor(m_actors[targets[next]].getX(), m_actors[targets[next]].getY());
+    showLineOfFire();
+}
+
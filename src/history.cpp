@@ -0,0 +1,153 @@
+#include "include/history.h"
+
+static ActorState captureState(const Actor &actor)
+{
+    return ActorState{actor.getX(), actor.getY(), actor.getEnergy(),
+	    static_cast<std::int_least16_t>(actor.getHealth()),
+	    actor.m_levelProgress, actor.isTurn()};
+}
+
+static void restoreState(Actor &actor, const ActorState &state)
+{
+    actor.move(state.x, state.y);
+    actor.setTurn(state.isTurn, state.energy);
+    actor.addHealth(state.health - actor.getHealth());
+    actor.m_levelProgress = state.levelProgress;
+}
+
+void History::popOldest()
+{
+    m_startBytes -= m_turns.front().start.bytes();
+    m_turns.pop_front();
+}
+
+/* Starts a new (empty) record for the turn about to be played, which began
+   from start, forgetting the oldest turns if the history is full*/
+void History::beginTurn(std::uint64_t hash, int playerIndex, int turnIndex,
+			TurnStart start)
+{
+    if(m_turns.size() >= static_cast<std::size_t>(MaxHistoryTurns)) {
+	popOldest();
+    }
+    while(!m_turns.empty() && m_startBytes + start.bytes() > MaxHistoryBytes) {
+	popOldest();
+    }
+    m_startBytes += start.bytes();
+    m_turns.push_back(TurnRecord{hash, playerIndex, turnIndex, {}, {}, {}, {}, std::move(start)});
+}
+
+/* Record functions are called before the change is made. Changes made
+   before the first turn begins (e.g. while loading a map) aren't undoable*/
+void History::recordTile(MapLayer layer, int x, int y, char previous)
+{
+    if(m_turns.empty()) return;
+    m_turns.back().changes.push_back(Change{ChangeKind::TILE, x, y, previous, {}, layer});
+}
+
+void History::recordActor(int index, const Actor &actor)
+{
+    if(m_turns.empty()) return;
+    m_turns.back().changes.push_back(Change{ChangeKind::ACTOR_STATE, index, 0, 0,
+		captureState(actor), {}});
+}
+
+void History::recordActorSnapshot(int index, const Actor &actor)
+{
+    if(m_turns.empty()) return;
+    TurnRecord &turn = m_turns.back();
+    turn.changes.push_back(Change{ChangeKind::ACTOR_SNAPSHOT, index,
+		static_cast<int>(turn.actors.size()), 0, {}, {}});
+    turn.actors.push_back(actor);
+}
+
+void History::recordActorErased(int index, const Actor &actor)
+{
+    if(m_turns.empty()) return;
+    TurnRecord &turn = m_turns.back();
+    turn.changes.push_back(Change{ChangeKind::ACTOR_ERASED, index,
+		static_cast<int>(turn.actors.size()), 0, {}, {}});
+    turn.actors.push_back(actor);
+}
+
+void History::recordActorAdded(int index)
+{
+    if(m_turns.empty()) return;
+    m_turns.back().changes.push_back(Change{ChangeKind::ACTOR_ADDED, index, 0, 0, {}, {}});
+}
+
+void History::recordItemErased(int index, const Item &item)
+{
+    if(m_turns.empty()) return;
+    TurnRecord &turn = m_turns.back();
+    turn.changes.push_back(Change{ChangeKind::ITEM_ERASED, index,
+		static_cast<int>(turn.items.size()), 0, {}, {}});
+    turn.items.push_back(item);
+}
+
+void History::recordPerception(int index, const Perception &perception)
+{
+    if(m_turns.empty()) return;
+    TurnRecord &turn = m_turns.back();
+    turn.changes.push_back(Change{ChangeKind::PERCEPTION, index,
+		static_cast<int>(turn.perceptions.size()), 0, {}, {}});
+    turn.perceptions.push_back(perception);
+}
+
+/* Called along with recordActorErased(); other monsters' targets after
+   index move down one place, and move back up when it's undone*/
+void History::recordPerceptionErased(int index, const Perception &perception)
+{
+    if(m_turns.empty()) return;
+    TurnRecord &turn = m_turns.back();
+    turn.changes.push_back(Change{ChangeKind::PERCEPTION_ERASED, index,
+		static_cast<int>(turn.perceptions.size()), 0, {}, {}});
+    turn.perceptions.push_back(perception);
+}
+
+/* Reverts the most recent turn's changes (newest first), then removes its
+   record, returning it so caller can restore the board's indexes/hash*/
+TurnRecord History::undoTurn(LayeredMap &map, ActorList &actors, ItemList &items,
+			     std::vector<Perception> &perception)
+{
+    TurnRecord turn = std::move(m_turns.back());
+    m_turns.pop_back();
+    m_startBytes -= turn.start.bytes();
+    for(auto it = turn.changes.rbegin(); it != turn.changes.rend(); ++it) {
+	const Change &change = *it;
+	switch(change.kind) {
+	case ChangeKind::TILE:
+	    map.layer(change.layer)[change.snapshot][change.index] = change.tile;
+	    break;
+	case ChangeKind::ACTOR_STATE:
+	    restoreState(actors[change.index], change.state);
+	    break;
+	case ChangeKind::ACTOR_SNAPSHOT:
+	    actors[change.index] = turn.actors[change.snapshot];
+	    break;
+	case ChangeKind::ACTOR_ERASED:
+	    actors.insert(actors.begin()+change.index, turn.actors[change.snapshot]);
+	    break;
+	case ChangeKind::ACTOR_ADDED:
+	    actors.erase(actors.begin()+change.index);
+	    if(change.index < static_cast<int>(perception.size())) {
+		perception.erase(perception.begin()+change.index);
+	    }
+	    break;
+	case ChangeKind::ITEM_ERASED:
+	    items.insert(items.begin()+change.index, turn.items[change.snapshot]);
+	    break;
+	case ChangeKind::PERCEPTION:
+	    perception[change.index] = turn.perceptions[change.snapshot];
+	    break;
+	case ChangeKind::PERCEPTION_ERASED:
+	    for(Perception &seen : perception) {
+		if(seen.target >= change.index) {
+		    ++seen.target;
+		}
+	    }
+	    perception.insert(perception.begin()+change.index, turn.perceptions[change.snapshot]);
+	    break;
+	}
+    }
+    return turn;
+}
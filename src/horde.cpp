@@ -0,0 +1,117 @@
+#include "include/horde.h"
+#include "include/trace.h"
+#include <algorithm>
+#include <cmath>
+
+/* Options for an arena with room for the given number of monsters (at
+   least 1), at HordeDensity tiles each, sent in the default waves*/
+HordeOptions hordeOfSize(int monsters, unsigned int seed)
+{
+    monsters = std::max(monsters, 1);
+    int side = std::sqrt(static_cast<double>(monsters) * HordeDensity);
+    HordeOptions options;
+    //Wider than tall, like the screen
+    options.width = std::max(side * 3 / 2, MapWidth);
+    options.height = std::max(side * 2 / 3, MapHeight);
+    options.maxMonsters = monsters;
+    options.waveSize = std::min(HordeWaveSize, monsters);
+    options.seed = seed;
+    return options;
+}
+
+/* Builds a walled arena, open but for a few pillars, with the player in
+   the middle; the monsters come later, in waves*/
+LevelMap generateArena(const HordeOptions &options, std::mt19937 &generator)
+{
+    LevelMap map(options.width, options.height);
+    std::uniform_int_distribution<int> percent(0, 99);
+    for(int row=0; row<map.height(); ++row) {
+	for(int col=0; col<map.width(); ++col) {
+	    bool edge = row == 0 || col == 0 || row == map.height() - 1
+		|| col == map.width() - 1;
+	    if(edge || percent(generator) < HordePillarPercent) {
+		map[row][col] = WallTile;
+	    }
+	}
+    }
+    map[map.height() / 2][map.width() / 2] = PlayerTile;
+    return map;
+}
+
+/* Sets the board up for the horde: the whole arena stays awake, and the
+   player is always being hunted. The first wave arrives straight away*/
+Horde::Horde(GameBoard &board, const HordeOptions &options)
+    : m_board(board), m_options(options), m_generator(options.seed),
+      m_nextWave(board.turn())
+{
+    for(const Actor &monster : board.tiles().monsters()) {
+	if(!monster.isElite()) {
+	    m_kinds.push_back(monster.getCh());
+	}
+    }
+    int across = board.map().width() + board.map().height();
+    board.setActivityRadii(across, across);
+    board.setHunted(true);
+}
+
+/* Number of monsters still alive*/
+int Horde::alive() const
+{
+    const ActorList &actors = m_board.actors();
+    return std::count_if(actors.begin(), actors.end(), [](const Actor &actor) {
+	return !actor.isPlayer() && actor.isAlive();
+    });
+}
+
+/* Spawns a wave of monsters at random free cells at least
+   HordeSpawnDistance from the player, as many as fit under maxMonsters;
+   returns how many were spawned. A crowded arena can leave a wave short*/
+int Horde::spawnWave()
+{
+    TRACE_SCOPE("Horde::spawnWave");
+    if(m_kinds.empty()) {
+	return 0;
+    }
+    const int width = m_board.map().width(), height = m_board.map().height();
+    //Spawning can move m_board's Actors, so keep the player's position
+    const int playerX = m_board.player().getX(), playerY = m_board.player().getY();
+    const int wanted = std::min(m_options.waveSize, m_options.maxMonsters - alive());
+    std::uniform_int_distribution<int> xDist(1, width - 2);
+    std::uniform_int_distribution<int> yDist(1, height - 2);
+    std::uniform_int_distribution<int> kind(0, m_kinds.size() - 1);
+    int spawned = 0;
+    for(int tries=0; spawned < wanted && tries < wanted * 10; ++tries) {
+	int x = xDist(m_generator);
+	int y = yDist(m_generator);
+	int dx = x - playerX, dy = y - playerY;
+	if(dx * dx + dy * dy >= HordeSpawnDistance * HordeSpawnDistance
+	   && m_board.spawnMonster(m_kinds[kind(m_generator)], x, y)) {
+	    ++spawned;
+	}
+    }
+    return spawned;
+}
+
+/* Call once per game loop: sends the next wave once its turn comes;
+   returns how many monsters arrived*/
+int Horde::update()
+{
+    if(m_board.turn() < m_nextWave) {
+	return 0;
+    }
+    m_nextWave = m_board.turn() + m_options.waveTurns;
+    return spawnWave();
+}
+
+/* Sends waves until maxMonsters are alive (or no more fit), as if the
+   horde had been arriving for a while; returns how many were spawned*/
+int Horde::fill()
+{
+    int total = 0;
+    int spawned;
+    do {
+	spawned = spawnWave();
+	total += spawned;
+    } while(spawned > 0);
+    return total;
+}
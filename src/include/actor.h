@@ -1,11 +1,13 @@
 #ifndef ACTOR_H
 #define ACTOR_H
 #include "item.h"
+#include <random>
 
 enum class Faction {
   PLAYER,
   MONSTER
 };
+constexpr int FactionCount = 2;
 
 class GameBoard;
 
@@ -13,6 +15,23 @@ constexpr int RNGUpperLimit = 100;
 constexpr int SkillAmount = 9; //Number of skills (e.g. strengh, agility, etc.)
 constexpr int MaxInitPoints = 25; //Total pts doled out at character creation
 
+//What an Actor brings to a fight; enough to resolve attacks without the Actor
+struct CombatStats {
+  int strength;
+  int armorBonus;
+  int meleeAttack; //-1 if no melee weapon equipped
+};
+
+bool resolveAttack(const CombatStats &attacker, const CombatStats &target,
+		   int &damage, std::mt19937 &generator);
+
+//A monster's next step, decided without changing the board
+struct MovePlan {
+  bool wait; //Nothing to go after; ends its turn
+  bool lookahead; //Elite that can see its target: search for a move first
+  int dx, dy; //Step towards its goal
+};
+
 class Actor {
 private:
   int /*m_id,*/ m_xPos, m_yPos, m_energy;
@@ -20,19 +39,22 @@ private:
   std::string m_name;
   bool m_isTurn;
   bool m_isPlayer;
+  bool m_isElite = false; //Elite monsters plan moves using lookahead search
   Faction m_faction = Faction::MONSTER;
 
   //Current Status - stats that change moment-to-moment from environment
   std::int_least16_t m_health = 15;
   Item m_equipment[EQUIP_MAX]; //Items being worn; helmet, shirt, pants, boots, weapons
-  std::vector<Item> m_inventory; //Contains items for player
+  ItemList m_inventory; //Contains items for player
 public:
   Actor(int x = 0, int y = 0, std::string name = "Monster", char ch = 'M',
 	bool isPlayer = false);
   bool operator==(const Actor &other) const;
   void move(int newX, int newY);
-  bool attack(Actor &target);
+  bool attack(Actor &target, std::mt19937 &generator);
+  CombatStats combatStats() const;
   void update(GameBoard *board);
+  MovePlan plan(const GameBoard &board) const;
   void setTurn(bool isTurn, int energy = 3);
   bool canCarry(int itemWeight) const;
   Item* getItemAt(int index);
@@ -41,7 +63,10 @@ public:
   void equipItem(int index, int position);
   void deequipItem(int position);
   Item* getEquipped(int index);
+  const Item* getEquipped(int index) const;
   void addHealth(int amount);
+  void applyTemplate(const Actor &temp);
+  void useAllocator(const ArenaAllocator<Item> &allocator);
   //Setters/Getters
   int getX() const { return m_xPos; }
   int getY() const { return m_yPos; }
@@ -56,6 +81,8 @@ public:
   bool isTurn() const { return m_isTurn; }
   bool isPlayer() const { return m_isPlayer; }
   bool isAlive() const { return m_health > 0; }
+  bool isElite() const { return m_isElite; }
+  void setElite(bool isElite) { m_isElite = isElite; }
   int getInventorySize() const { return m_inventory.size(); }
   std::int_least16_t m_carryWeight = 0; //Current weight of inventory
   std::int_least16_t m_maxCarryWeight = 20;
@@ -75,4 +102,7 @@ public:
   std::int_least16_t m_barterSkill = 0;    // 3 - Skill affecting cost of items
   std::int_least16_t m_negotiateSkill = 0; // 4 - Skill affecting chance of successful negotiations
 };
+
+//Actors on a level, from the level's Arena
+typedef std::vector<Actor, ArenaAllocator<Actor>> ActorList;
 #endif
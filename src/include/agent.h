@@ -0,0 +1,64 @@
+#ifndef AGENT_H
+#define AGENT_H
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "gameboard.h"
+
+constexpr int AgentViewRadius = 10; //Tiles visible in each direction from player
+constexpr char UnseenGlyph = ' '; //Shown for cells in view range the player can't see
+
+//Another Actor as the player sees it
+struct ActorView {
+    char ch;
+    std::string name;
+    int x, y, health;
+};
+
+//Everything a program playing the game is told between actions
+struct Observation {
+    int turn;
+    std::uint64_t hash;
+    bool alive;
+    int x, y, health, energy;
+    //Map position of the top-left corner of tiles
+    int viewX, viewY;
+    std::vector<std::string> tiles;
+    std::vector<ActorView> actors;
+    std::vector<std::string> inventory;
+    std::vector<std::string> equipped; //One per equip slot; "" if empty
+    std::vector<std::string> log; //Messages since last observation
+};
+
+enum class ActionType {
+    MOVE,         //a, b = dx, dy
+    TELEPORT,     //a, b = x, y
+    RANGE_ATTACK, //a, b = x, y
+    EQUIP,        //a = inventory index, b = equip slot
+    DEEQUIP,      //a = equip slot
+    WAIT          //Give up rest of turn
+};
+
+struct Action {
+    ActionType type;
+    int a, b;
+};
+
+class Agent {
+//Purpose: To let a program play as the player on a headless GameBoard,
+//    reporting what the player can see and running the monsters' turns
+//    after each of the player's turns
+private:
+    GameBoard &m_board;
+public:
+    explicit Agent(GameBoard &board);
+    Observation observe();
+    bool act(const Action &action);
+    bool isOver() { return !m_board.player().isAlive(); }
+};
+
+bool parseAction(const std::string &line, Action &action);
+void writeObservation(std::ostream &out, const Observation &observation);
+void runAgentProtocol(GameBoard &board, std::istream &in, std::ostream &out);
+#endif
@@ -0,0 +1,83 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+constexpr std::size_t ArenaBlockSize = 64 * 1024; //Bytes per block, unless one allocation needs more
+
+class Arena {
+//Purpose: Memory for one level's objects (its Actors, Items and the
+//    inventories of its Actors), handed out from a few large blocks by
+//    bumping a pointer. Nothing is freed on its own: it all goes at once,
+//    in reset(), when the level is unloaded. The first block is kept for
+//    the next level. Not thread-safe; only the board's thread allocates
+private:
+    struct Block {
+	std::unique_ptr<char[]> memory;
+	std::size_t size;
+    };
+    std::vector<Block> m_blocks;
+    char *m_next, *m_end; //Free part of the newest block
+    std::size_t m_used; //Bytes handed out since the last reset
+    void addBlock(std::size_t atLeast);
+public:
+    Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    void* allocate(std::size_t bytes, std::size_t alignment);
+    void reset();
+    int blockCount() const { return m_blocks.size(); }
+    std::size_t bytesUsed() const { return m_used; }
+    bool owns(const void *memory) const;
+};
+
+template<typename T>
+class ArenaAllocator {
+//Purpose: Lets standard containers take their memory from an Arena; with
+//    no Arena it uses the heap. Copies of a container go on the heap, so
+//    copying an object out of a level (e.g. for undo) never leaves it
+//    pointing into memory the next level reuses. Moves and swaps bring the
+//    Arena along with the memory
+private:
+    Arena *m_arena;
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+    ArenaAllocator() noexcept : m_arena(nullptr) {}
+    explicit ArenaAllocator(Arena *arena) noexcept : m_arena(arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) noexcept : m_arena(other.arena()) {}
+    T* allocate(std::size_t count)
+    {
+	if(m_arena) {
+	    return static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T)));
+	}
+	return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+    //Arena memory is only released by Arena::reset()
+    void deallocate(T *memory, std::size_t) noexcept
+    {
+	if(!m_arena) {
+	    ::operator delete(memory);
+	}
+    }
+    ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator(); }
+    Arena* arena() const { return m_arena; }
+};
+
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+    return a.arena() == b.arena();
+}
+
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+    return !(a == b);
+}
+#endif
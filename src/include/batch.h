@@ -0,0 +1,39 @@
+#ifndef BATCH_H
+#define BATCH_H
+#include <iosfwd>
+#include <string>
+#include "threadpool.h"
+
+constexpr int BatchMaxTurns = 500; //Games still going after this are timeouts
+
+struct BatchOptions {
+    int games;
+    std::string mapPath;
+    unsigned int seed; //Game i is played with seed + i
+    int maxTurns = BatchMaxTurns;
+    int threads = ThreadPool::defaultThreadCount();
+};
+
+//How one automated playthrough ended
+struct GameResult {
+    bool won; //All monsters killed
+    bool died;
+    int turns;
+    int kills;
+    int health;
+};
+
+struct BatchReport {
+    int games, threads;
+    int wins, deaths, timeouts;
+    long totalTurns;
+    int minTurns, maxTurns;
+    long totalKills;
+    long survivorHealth; //Summed over games the player survived
+    double seconds;
+};
+
+GameResult playGame(const BatchOptions &options, unsigned int seed);
+BatchReport runBatch(const BatchOptions &options);
+void writeReport(std::ostream &out, const BatchReport &report);
+#endif
@@ -0,0 +1,87 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+#include <cstdint>
+#include <vector>
+#include "display.h"
+
+constexpr int BitsPerWord = 64;
+
+//Position of the lowest set bit of a non-zero word
+inline int lowestBit(std::uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+    while(!((word >> bit) & 1)) {
+	++bit;
+    }
+    return bit;
+#endif
+}
+
+class Bitboard {
+//Purpose: One bit per map cell, packed 64 cells to a word along each row
+//    (x's bit is x % 64 of word x / 64), so whole-map queries like flood
+//    fills and neighbour counts handle 64 cells per operation. Bits past
+//    the map's width are always 0
+private:
+    int m_width, m_height;
+    int m_rowWords; //Words per row
+    std::vector<std::uint64_t> m_bits; //Row-major
+    void clearPadding();
+public:
+    Bitboard(int width = MapWidth, int height = MapHeight);
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int rowWords() const { return m_rowWords; }
+    std::uint64_t* row(int y) { return &m_bits[y * m_rowWords]; }
+    const std::uint64_t* row(int y) const { return &m_bits[y * m_rowWords]; }
+    bool test(int x, int y) const
+    {
+	return (row(y)[x / BitsPerWord] >> (x % BitsPerWord)) & 1;
+    }
+    void set(int x, int y, bool value = true)
+    {
+	std::uint64_t bit = std::uint64_t(1) << (x % BitsPerWord);
+	std::uint64_t &word = row(y)[x / BitsPerWord];
+	word = value ? word | bit : word & ~bit;
+    }
+    void clear();
+    bool operator==(const Bitboard &other) const { return m_bits == other.m_bits; }
+    bool operator!=(const Bitboard &other) const { return m_bits != other.m_bits; }
+    bool any() const;
+    int count() const;
+    Bitboard& operator|=(const Bitboard &other);
+    Bitboard& operator&=(const Bitboard &other);
+    Bitboard& andNot(const Bitboard &other);
+    Bitboard inverted() const;
+    //Set cells plus their 8 neighbours
+    Bitboard dilated() const;
+    //Cells with at least count of their 8 neighbours set
+    Bitboard neighboursAtLeast(int count) const;
+    //Set cells connected (8-way, through set cells) to a set cell at x, y
+    Bitboard floodFill(int x, int y) const;
+    //Calls visit(x, y) for each set cell in the box between two corners
+    //(inclusive), skipping a word at a time where none are set
+    template<typename Visit>
+    void forEachSet(int x0, int y0, int x1, int y1, Visit visit) const
+    {
+	const int firstWord = x0 / BitsPerWord, lastWord = x1 / BitsPerWord;
+	for(int y=y0; y<=y1; ++y) {
+	    const std::uint64_t *words = row(y);
+	    for(int word=firstWord; word<=lastWord; ++word) {
+		std::uint64_t bits = words[word];
+		if(word == firstWord) bits &= ~std::uint64_t(0) << (x0 % BitsPerWord);
+		if(word == lastWord) bits &= ~std::uint64_t(0) >> (BitsPerWord - 1 - x1 % BitsPerWord);
+		for(; bits != 0; bits &= bits - 1) {
+		    visit(word * BitsPerWord + lowestBit(bits), y);
+		}
+	    }
+	}
+    }
+    //Whether a set cell lies on the line between two cells (ends excluded)
+    bool lineBlocked(int x0, int y0, int x1, int y1) const;
+    static Bitboard fromLayer(const LevelMap &layer);
+};
+#endif
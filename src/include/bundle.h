@@ -0,0 +1,30 @@
+#ifndef BUNDLE_H
+#define BUNDLE_H
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "actor.h"
+#include "item.h"
+
+constexpr std::uint32_t BundleVersion = 1; //Bump whenever the layout changes
+
+//Monster/item templates as the game uses them, and where they came from
+struct TemplateSet {
+    std::map<char,Actor> monsters;
+    std::map<char,Item> items;
+    std::vector<std::string> errors; //As "file:line: message"
+    bool fromBundle = false;
+};
+
+//Template files/bundle, relative to the game's directory
+std::string monstersPath(const std::string &dir);
+std::string itemsPath(const std::string &dir);
+std::string bundlePath(const std::string &dir);
+
+TemplateSet loadTemplateSet(const std::string &dir);
+TemplateSet loadTemplateSetFromIni(const std::string &dir);
+TemplateSet loadTemplateSetFromIni(const std::string &monstersFile, const std::string &itemsFile);
+bool readTemplateBundle(const std::string &dir, TemplateSet &templates);
+bool writeTemplateBundle(const std::string &dir, std::vector<std::string> &errors);
+#endif
@@ -1,7 +1,9 @@
 #ifndef DISPLAY_TERMBOX_H
 #define DISPLAY_TERMBOX_H
 #include <string>
+#include <vector>
 #include "termbox.h"
+#include "perf.h"
 
 //Display Constants
 constexpr int MinDisplayWidth = 30;
@@ -18,12 +20,57 @@ constexpr int MaxLogSize = 4; //in number of messages
 
 //Map Constants
 //  Map should take up at least min screen space so min-size screen is always full
+//  (map files are loaded at this size; generated maps can be larger)
 constexpr int MapWidth = 30;
 constexpr int MapHeight = 30;
-//  An array containing tiles to display onscreen
-typedef char LevelMap[MapWidth][MapHeight];
+
+class LevelMap {
+//Purpose: Grid of tiles to display onscreen, indexed as map[y][x]; 0 is empty
+private:
+    int m_width, m_height;
+    std::vector<char> m_tiles; //Row-major
+public:
+    LevelMap(int width = MapWidth, int height = MapHeight)
+	: m_width(width), m_height(height), m_tiles(width * height, 0) {}
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    char* operator[](int row) { return &m_tiles[row * m_width]; }
+    const char* operator[](int row) const { return &m_tiles[row * m_width]; }
+};
+
+//Layers of a LayeredMap
+enum class MapLayer { TERRAIN, ACTORS, ITEMS };
+constexpr int MapLayerCount = 3;
+
+class LayeredMap {
+//Purpose: A level kept as separate layers, each one char per cell (0 is
+//    empty), so an Actor standing on something doesn't erase it: terrain
+//    (walls), the char of the Actor in each cell, and the char of the Items
+//    lying there. The ACTORS layer only says what to draw; which Actor
+//    stands in a cell is kept by index in GameBoard's actor grid, which
+//    changePos(), spawning and deleting keep in step with this layer
+private:
+    LevelMap m_layers[MapLayerCount];
+public:
+    LayeredMap(int width = MapWidth, int height = MapHeight)
+	: m_layers{LevelMap(width, height), LevelMap(width, height), LevelMap(width, height)} {}
+    int width() const { return m_layers[0].width(); }
+    int height() const { return m_layers[0].height(); }
+    LevelMap& layer(MapLayer layer) { return m_layers[static_cast<int>(layer)]; }
+    const LevelMap& layer(MapLayer layer) const { return m_layers[static_cast<int>(layer)]; }
+    const LevelMap& terrain() const { return layer(MapLayer::TERRAIN); }
+    const LevelMap& actors() const { return layer(MapLayer::ACTORS); }
+    const LevelMap& items() const { return layer(MapLayer::ITEMS); }
+    //Char shown for a cell: its Actor, else its Items, else its terrain
+    char top(int x, int y) const
+    {
+	if(actors()[y][x] != 0) return actors()[y][x];
+	return items()[y][x] != 0 ? items()[y][x] : terrain()[y][x];
+    }
+};
 
 class Actor;
+class TileTable;
 
 class Display {
 //Purpose: Puts/manages content onscreen using termbox library
@@ -39,17 +86,25 @@ private:
     std::string m_log[MaxLogSize];
     //Row that next log message should display on; number of log messages stored
     int m_logRow;
+    //Headless displays draw into m_cells instead of the terminal
+    bool m_headless;
+    int m_headlessWidth, m_headlessHeight;
+    std::vector<tb_cell> m_cells;
+    PerfOverlay m_perf;
+    inline int width() { return m_headless ? m_headlessWidth : tb_width(); }
+    inline int height() { return m_headless ? m_headlessHeight : tb_height(); }
     //boardWidth/Height are dimensions of current window bounded on sides by GUI
-    inline int boardWidth() { return tb_width()-GUIWidth; }
-    inline int boardHeight() { return tb_height()-GUIHeight; }
+    inline int boardWidth() { return width()-GUIWidth; }
+    inline int boardHeight() { return height()-GUIHeight; }
     void clearChar(int col, int row);
     void putChar(int col, int row, char letter,
 		 const uint16_t fg = TB_WHITE, const uint16_t bg = TB_BLACK);
-    int getCameraCoord(int playerCoord, bool isX);
-    void drawGUI(const Actor &player);
+    int getCameraCoord(int playerCoord, int mapSize, bool isX);
     inline int convertCoord(int coord, bool isX);
+    void drawPerf();
 public:
     Display();
+    Display(int width, int height);
     ~Display();
     bool getInput();
     //x and y = coords in terms of game map, not display
@@ -66,10 +121,13 @@ public:
     void printTextCol(int gridCol, const std::string text,
 		      const uint16_t fg = TB_WHITE, const uint16_t bg = TB_BLACK);
     //Note: draw functions alter screen buffer; must call present() to push to display
-    void draw(const LevelMap &map, const Actor &player);
+    void draw(const LayeredMap &map, const TileTable &tiles, const Actor &player);
+    void drawGUI(const Actor &player);
+    void highlight(int x, int y, char glyph, const uint16_t fg, const uint16_t bg);
     //Setters/Getters
-    void clear() { tb_clear(); }
-    void present() { tb_present(); }
+    void clear();
+    void present();
+    PerfOverlay& perf() { return m_perf; }
     bool largeEnough();
     int getEventType() { return m_event.type; };
     int getEventKey() { return m_event.key; }
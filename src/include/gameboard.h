@@ -3,47 +3,250 @@
 #include "display.h"
 #include "actor.h"
 #include "template.h"
+#include "tiles.h"
+#include "bitboard.h"
+#include "regions.h"
+#include "pathing.h"
+#include "scent.h"
+#include "history.h"
+#include "arena.h"
+#include "threadpool.h"
+#include "lookahead.h"
+#include "watcher.h"
+#include <memory>
 #include <map>
+#include <queue>
+#include <cstdint>
+
+constexpr int ActivityRadius = 20; //Monsters this near the player wake up
+constexpr int SleepRadius = 40; //Awake monsters farther than this go dormant
+constexpr int NoiseRadius = 8; //Fights wake dormant monsters this close
+constexpr int SightRadius = 10; //How far the player can see (and explores)
+constexpr int TravelFrameMs = 50; //Travel/explore redraw at most this often
+constexpr int MaxTravelSteps = 1000; //Travel/explore stop after this many steps
+constexpr int MaxTargets = 16; //Most targets the cursor cycles through
+constexpr int MinNoticeRadius = 2; //Monsters always notice a player this close
+constexpr int MemoryTurns = 10; //Turns a monster keeps after where it last saw the player
+constexpr int PerceptionChunk = 128; //Awake monsters per parallel perception task
+constexpr int PlanChunk = 512; //Monsters per parallel planning task
+//m_turn_index while the monsters are taking their turns
+constexpr int MonstersTurn = -1;
+//Ticks to wait for monsters to finish their turns before giving up
+constexpr int MaxTicksPerTurn = 100000;
+
+//What a line of fire runs into first
+enum class LineHit { NOTHING, ACTOR, WALL, OFF_MAP };
+struct LineOfFire {
+    LineHit hit;
+    //Where the line stops: the wall/Actor hit, the last cell on the map if
+    //it runs off the edge, else its end
+    int x, y;
+};
 
 class GameBoard {
 //Purpose: To represent the game map/the actors/pieces on it, as well as to
 //    handle user input for controlling the player
 private:
-    LevelMap m_map;
-    Display &m_screen;
+    //Terrain, plus where each Actor/Item is, as separate layers
+    LayeredMap m_map;
+    //Bit-packed copies of the terrain (blocks movement and sight) and actor
+    //layers for whole-map queries; kept in step by setTile()
+    Bitboard m_walls, m_occupied;
+    //Which open cells can reach each other, kept in step with m_walls
+    RegionMap m_regions;
+    //Per cell (row-major), index into m_actors of the Actor there, -1 if
+    //none; with m_occupied, finds the Actors around a cell without going
+    //through every Actor
+    std::vector<int> m_actorGrid;
+    //Per Faction, the cells its living Actors are in, kept in step with
+    //m_actorGrid, so a search for hostiles skips the viewer's own side
+    Bitboard m_factionCells[FactionCount];
+    //Trail the player leaves for monsters that can't see them to follow
+    ScentMap m_scent;
+    //Cells the player has seen; what auto-explore heads for the rest of
+    Bitboard m_explored;
+    //Set while travelling, so the screen is drawn per frame, not per move
+    bool m_travelling;
+    //Set when the board has changed since it was last drawn; moves/fights
+    //set it rather than drawing, so a tick of many of them draws once, at
+    //present()
+    bool m_changed;
+    //Action the cursor was shown for, while it's shown
+    bool (GameBoard::*m_cursorAction)(Actor&, int, int);
+    Display *m_screen; //nullptr if running headless
     //m_player_index is always location of player object in m_actors
     int m_player_index;
-    //m_turn_index is always location of object whose turn it is in m_actors
+    //m_turn_index is m_player_index during the player's turn, else MonstersTurn
     int m_turn_index;
-    std::vector<Item> m_items;
-    std::vector<Actor> m_actors;
-    std::map<char,Actor> m_templates;
-    std::map<char,Item> m_itemTemplates;
+    //Indexes (ascending) into m_actors of the actors near enough the player
+    //to be updated/take turns; the rest are dormant until woken
+    std::vector<int> m_awake;
+    //ActivityRadius/SleepRadius, unless changed (e.g. so a whole arena's awake)
+    int m_activityRadius, m_sleepRadius;
+    //Every awake monster knows where the player is, as if it could see them
+    bool m_hunted;
+    WakeQueue m_wakeEvents;
+    //Per Actor (same indexes as m_actors), what it perceives of the player;
+    //only kept up to date for awake monsters
+    std::vector<Perception> m_perception;
+    std::vector<Perception> m_perceived; //perceive()'s results, by position in m_awake
+    //Indexes (ascending) of the monsters taking a step this tick, -1 once
+    //deleted, and the step each planned
+    std::vector<int> m_planned;
+    std::vector<MovePlan> m_plans;
+    //Where the current level's Actors/Items (and their inventories) live;
+    //declared first so it outlives them, and reset when a map is loaded
+    Arena m_arena;
+    ItemList m_items;
+    ActorList m_actors;
+    //What each map char is, with the monster/item templates they're made from
+    TileTable m_tiles;
+    //Zobrist hash of tiles/actors/items, kept up to date by every mutation
+    std::uint64_t m_hash;
+    //m_turnHashes[n] is m_hash at the start of the player's nth turn
+    std::vector<std::uint64_t> m_turnHashes;
+    //Per-turn undo records for rewinding
+    History m_history;
+    //Workers for elite monsters' lookahead search and for perception;
+    //started on first use
+    std::unique_ptr<ThreadPool> m_searchPool;
+    int m_searchThreads; //0 to do that work on the calling thread
+    //Rollouts per lookahead search, or 0 to search for a share of
+    //LookaheadBudgetMs per monsters' turn
+    int m_lookaheadRollouts;
+    //When the monsters' turn's search time runs out, and how many searches
+    //may still come before then (one per energy the searching elites have)
+    SearchClock::time_point m_lookaheadDeadline;
+    int m_searchesLeft;
+    //All of this board's randomness comes from here, so boards are independent
+    std::mt19937 m_generator;
+    //Id for the next Item placed on this board; ids count per board too
+    int m_nextItemId;
+    //Reparses the template files when they change; nullptr if not watching
+    std::unique_ptr<TemplateWatcher> m_templateWatcher;
+    bool m_updateLiveTemplates; //Reloads also update monsters already spawned
+    int indexOf(const Actor &actor) const { return &actor - &m_actors[0]; }
+    void beginChange(Actor &actor, bool snapshot = false);
+    void endChange(const Actor &actor);
+    TurnStart turnStart() const;
+    void restoreTurnStart(const TurnStart &start);
+    void beginTurn();
+    void updateActivity();
+    void beginMonstersTurn();
+    bool stepMonsters();
+    void forChunks(int count, int chunk, const std::function<void(int, int)> &work);
+    void perceive();
+    void perceiveRange(int first, int last);
+    bool notices(const Actor &monster, const Actor &target, bool noticed) const;
+    void numberItems(Actor &actor);
+    std::vector<int> nearestActorsIn(const Bitboard &cells, int x, int y, int radius, int count,
+				     const std::function<bool(const Actor&)> &accept) const;
+    Bitboard& factionCells(const Actor &actor)
+    {
+	return m_factionCells[static_cast<int>(actor.getFaction())];
+    }
+    void applyReloadedTemplates();
+    void setTile(MapLayer layer, int x, int y, char ch);
+    void rebuildBitboards();
+    void checkReachable();
+    void markSeen();
+    const Actor* monsterInView();
+    int travel(const std::function<bool(int, int)> &isGoal);
     void deleteItem(int x, int y);
     void deleteActor(int x, int y);
+    //Messages logged while headless, waiting for takeMessages()
+    std::vector<std::string> m_messages;
+    void refresh();
+    void markChanged() { m_changed = true; }
     bool changePos(Actor &actor, int newX, int newY);
     bool pickupItem(Actor &actor, int x, int y);
+    bool hasItemAt(int x, int y) const;
     bool melee(Actor &attacker, int targetX, int targetY);
 public:
-    GameBoard(Display &screen, Actor playerCh, const std::string &mapPath);
+    GameBoard(Display *screen, Actor playerCh, const std::string &mapPath,
+	      unsigned int seed = std::random_device{}());
+    GameBoard(Display *screen, Actor playerCh, const LevelMap &tiles,
+	      unsigned int seed = std::random_device{}());
     inline Actor& player() { return m_actors[m_player_index]; }
-    inline Actor& currActor() { return m_actors[m_turn_index]; }
+    inline Actor& actorAt(int index) { return m_actors[index]; }
+    const LayeredMap& map() const { return m_map; }
+    const Bitboard& walls() const { return m_walls; }
+    const Bitboard& occupied() const { return m_occupied; }
+    bool isOpen(int x, int y) const { return !m_walls.test(x, y) && !m_occupied.test(x, y); }
+    const RegionMap& regions() const { return m_regions; }
+    const Bitboard& explored() const { return m_explored; }
+    const ScentMap& scent() const { return m_scent; }
+    bool canSee(int x, int y) const;
+    //Index of the Actor in a cell; -1 if there's none or the cell is off the map
+    int actorIndexAt(int x, int y) const
+    {
+	return isValid(x, y) ? m_actorGrid[y * m_map.width() + x] : -1;
+    }
+    std::vector<int> nearestActors(int x, int y, int radius, int count,
+				   const std::function<bool(const Actor&)> &accept) const
+    {
+	return nearestActorsIn(m_occupied, x, y, radius, count, accept);
+    }
+    std::vector<int> nearestHostiles(const Actor &viewer, int radius, int count,
+				     bool visibleOnly) const;
+    Perception perceptionOf(const Actor &monster) const;
+    const Actor* targetFor(const Actor &monster) const;
+    void cycleTarget();
+    LineOfFire traceFire(int fromX, int fromY, int toX, int toY,
+			 std::vector<PathStep> *cells = nullptr) const;
+    void showLineOfFire();
+    //Whether a could ever walk to b (ignoring Actors in the way)
+    bool sameRegion(const Actor &a, const Actor &b) const
+    {
+	return m_regions.sameRegion(a.getX(), a.getY(), b.getX(), b.getY());
+    }
+    const ActorList& actors() const { return m_actors; }
+    //Number of player turns played before the current one
+    int turn() const { return m_turnHashes.size() - 1; }
     void loadMap(const std::string &path);
+    void loadMap(const LevelMap &tiles);
+    bool spawnMonster(char ch, int x, int y);
+    const std::vector<int>& awakeActors() const { return m_awake; }
+    bool isAwake(int index) const;
+    void wakeNear(int x, int y, int radius);
+    void scheduleWake(int x, int y, int radius, int turns);
+    void setActivityRadii(int activity, int sleep);
+    void setHunted(bool hunted) { m_hunted = hunted; }
+    const TileTable& tiles() const { return m_tiles; }
+    const Arena& arena() const { return m_arena; }
+    void watchTemplates(const std::string &monstersFile, const std::string &itemsFile,
+			bool updateLive = true);
     void bindCursorMode(Actor &actor, bool (GameBoard::*action)(Actor&, int, int));
     void updateActors();
+    void finishPlayerTurn();
     void showInventory(Actor &actor);
     void showStats(Actor &actor);
     void showEquipped(Actor &actor);
     void equipItem(Actor &actor);
+    bool equipItem(Actor &actor, int index, int position);
     void deequipItem(Actor &actor);
+    bool deequipItem(Actor &actor, int position);
+    void endTurn(Actor &actor);
+    bool rewind(int turns);
+    void rewindTurns();
     void log(const std::string &text);
+    std::vector<std::string> takeMessages();
     void redraw();
     void present();
     bool isValid(int x, int y) const;
     bool moveActor(Actor &actor, int newX, int newY);
     bool rangeAttack(Actor& attacker, int targetX, int targetY);
     bool translateActor(Actor &actor, int dx, int dy);
+    bool lookaheadStep(Actor &actor);
+    void commitPlan(Actor &monster, const MovePlan &plan);
+    void setSearchThreads(int threads) { m_searchThreads = threads; }
+    void setLookaheadRollouts(int rollouts) { m_lookaheadRollouts = rollouts; }
     void movePlayer(int newX, int newY);
     void translatePlayer(int dx, int dy);
+    bool travelTo(Actor &actor, int x, int y);
+    bool autoExplore();
+    std::uint64_t hash() const { return m_hash; }
+    std::uint64_t computeHash() const;
+    const std::vector<std::uint64_t>& turnHashes() const { return m_turnHashes; }
 };
 #endif
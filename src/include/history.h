@@ -0,0 +1,114 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+#include "display.h"
+#include "actor.h"
+#include "scent.h"
+
+constexpr int MaxHistoryTurns = 1000; //Oldest turns are forgotten past this
+//...or once their TurnStarts take up more than this (e.g. on huge levels)
+constexpr std::size_t MaxHistoryBytes = 64 * 1024 * 1024;
+
+//The parts of an Actor changed by moving/fighting/starting a turn
+struct ActorState {
+    int x, y, energy;
+    std::int_least16_t health, levelProgress;
+    bool isTurn;
+};
+
+enum class ChangeKind {
+    TILE,           //A map cell's char changed in one layer
+    ACTOR_STATE,    //An Actor moved/fought/started its turn
+    ACTOR_SNAPSHOT, //An Actor's inventory/equipment changed
+    ACTOR_ERASED,   //An Actor was removed from the board
+    ACTOR_ADDED,    //An Actor was added to the end of the actor list
+    ITEM_ERASED,    //An Item was removed from the board
+    PERCEPTION,     //A monster's Perception changed
+    PERCEPTION_ERASED //A Perception was removed along with its monster
+};
+
+//One undoable change; only holds the state from before the change
+struct Change {
+    ChangeKind kind;
+    int index;    //Position in actor/item list, or tile's x
+    int snapshot; //Position in TurnRecord's actors/items/perceptions, or tile's y
+    char tile;
+    ActorState state;
+    MapLayer layer; //Layer of a changed tile
+};
+
+//What a monster knows of the player, worked out at the start of each turn
+struct Perception {
+    bool seesPlayer;
+    int lastX, lastY; //Where it last saw the player
+    int lastSeen; //Turn it last saw them then, or -1 once that's no use
+    int target; //Index of the nearest hostile it noticed this turn, or -1
+    bool operator==(const Perception &other) const
+    {
+	return seesPlayer == other.seesPlayer && lastX == other.lastX && lastY == other.lastY
+	    && lastSeen == other.lastSeen && target == other.target;
+    }
+};
+
+//A scheduled wake-up of the dormant monsters around a position
+struct WakeEvent {
+    int turn, x, y, radius;
+    bool operator>(const WakeEvent &other) const { return turn > other.turn; }
+};
+typedef std::priority_queue<WakeEvent, std::vector<WakeEvent>, std::greater<WakeEvent>> WakeQueue;
+
+//What a turn plays out from besides the tiles and pieces, as it was when
+//the turn began; restoring it makes a rewound turn replay as it first did
+struct TurnStart {
+    std::mt19937 generator;
+    std::vector<int> awake; //GameBoard's m_awake
+    WakeQueue wakeEvents;
+    ScentSnapshot scent;
+    std::size_t bytes() const
+    {
+	return sizeof(TurnStart) + awake.size() * sizeof(int)
+	    + wakeEvents.size() * sizeof(WakeEvent) + scent.cells.size() * sizeof(float);
+    }
+};
+
+//Everything needed to return the board to the start of one player turn
+struct TurnRecord {
+    std::uint64_t hash;
+    int playerIndex, turnIndex;
+    std::vector<Change> changes;
+    //Whole objects only kept for changes that need them
+    std::vector<Actor> actors;
+    std::vector<Item> items;
+    std::vector<Perception> perceptions;
+    TurnStart start;
+};
+
+class History {
+//Purpose: To record what changes on a GameBoard during each turn, so that
+//    turns can be undone without storing a copy of the board per turn
+private:
+    std::deque<TurnRecord> m_turns;
+    std::size_t m_startBytes = 0; //Total bytes() of m_turns' TurnStarts
+    void popOldest();
+public:
+    void clear() { m_turns.clear(); m_startBytes = 0; }
+    int size() const { return m_turns.size(); }
+    void beginTurn(std::uint64_t hash, int playerIndex, int turnIndex,
+		   TurnStart start = TurnStart());
+    void recordTile(MapLayer layer, int x, int y, char previous);
+    void recordActor(int index, const Actor &actor);
+    void recordActorSnapshot(int index, const Actor &actor);
+    void recordActorErased(int index, const Actor &actor);
+    void recordActorAdded(int index);
+    void recordItemErased(int index, const Item &item);
+    void recordPerception(int index, const Perception &perception);
+    void recordPerceptionErased(int index, const Perception &perception);
+    TurnRecord undoTurn(LayeredMap &map, ActorList &actors, ItemList &items,
+			std::vector<Perception> &perception);
+};
+#endif
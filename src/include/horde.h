@@ -0,0 +1,48 @@
+#ifndef HORDE_H
+#define HORDE_H
+#include <random>
+#include <vector>
+#include "gameboard.h"
+
+constexpr int HordeMonsters = 5000; //Live monsters a horde builds up to
+constexpr int HordeWaveSize = 500; //Monsters sent in each wave
+constexpr int HordeWaveTurns = 5; //Player turns between waves
+constexpr int HordeDensity = 6; //Arena tiles per monster at full strength
+//Waves arrive at least this far from the player, out of their sight
+constexpr int HordeSpawnDistance = 2 * SightRadius;
+constexpr int HordePillarPercent = 2; //Chance an arena tile is a pillar
+constexpr int HordePlayerHealth = 500; //Extra health, to hold out a while
+//Most time from a player's action to the frame showing the monsters' moves
+constexpr int HordeFrameBudgetMs = 16;
+
+struct HordeOptions {
+    int width, height;
+    int maxMonsters = HordeMonsters;
+    int waveSize = HordeWaveSize;
+    int waveTurns = HordeWaveTurns;
+    unsigned int seed;
+};
+
+HordeOptions hordeOfSize(int monsters, unsigned int seed);
+LevelMap generateArena(const HordeOptions &options, std::mt19937 &generator);
+
+class Horde {
+//Purpose: Horde mode: sends waves of monsters (made from every monster
+//    template but the elites, whose searches are too slow for thousands)
+//    into an arena out of the player's sight, until maxMonsters are alive
+//    at once. The whole arena is kept awake and every monster knows where
+//    the player is, so all of them close in together
+private:
+    GameBoard &m_board;
+    HordeOptions m_options;
+    std::mt19937 m_generator;
+    std::vector<char> m_kinds; //Monster chars waves are made of
+    int m_nextWave; //Turn the next wave arrives
+public:
+    Horde(GameBoard &board, const HordeOptions &options);
+    int alive() const;
+    int spawnWave();
+    int update();
+    int fill();
+};
+#endif
@@ -2,6 +2,7 @@
 #define ITEM_GAME_H
 #include <string>
 #include <vector>
+#include "arena.h"
 
 enum Equipment {
     ARMOR_HELMET,
@@ -17,6 +18,7 @@ const int ARMOR_MAX = ARMOR_BOOTS + 1;
 
 class Item {
 private:
+    //m_id is unique among a board's Items; -1 until the board numbers it
     int m_xPos, m_yPos, m_id, m_weight;
     std::string m_name;
     bool m_isEquipped = false;
@@ -33,6 +35,7 @@ public:
     int getX() const { return m_xPos; }
     int getY() const { return m_yPos; }
     int getId() const { return m_id; }
+    void setId(int id) { m_id = id; }
     void setWeight(int value) { m_weight = value; }
     int getWeight() const { return m_weight; }
     std::int_least16_t getArmor() const { return m_armor; }
@@ -47,4 +50,7 @@ public:
     void setRanged(bool isRanged) { m_isRanged = isRanged; }
     void setMelee(bool isMelee) { m_isMelee = isMelee; }
 };
+
+//Items on a level/in an inventory, from the level's Arena (if given one)
+typedef std::vector<Item, ArenaAllocator<Item>> ItemList;
 #endif
@@ -0,0 +1,42 @@
+#ifndef LOOKAHEAD_H
+#define LOOKAHEAD_H
+#include <chrono>
+#include <vector>
+#include "display.h"
+#include "actor.h"
+#include "threadpool.h"
+
+//Time spent searching per monsters' turn, shared by the elites searching in it
+constexpr int LookaheadBudgetMs = 5;
+constexpr int LookaheadRadius = 8; //Farther from player, elites move greedily
+constexpr int LookaheadDepth = 18; //Actions simulated per rollout
+constexpr int LookaheadWindow = 2 * LookaheadRadius; //Tiles copied in each direction
+constexpr int TurnEnergy = 3; //Energy each Actor gets at start of its turn
+//Rollouts per move when the search is limited by count rather than time, so
+//seeded games replay the same on any machine; split over LookaheadRoots
+//roots however many workers there are
+constexpr int LookaheadRollouts = 2048;
+constexpr int LookaheadRoots = 4;
+
+//An Actor reduced to what a simulated fight needs
+struct Combatant {
+    int x, y, health, energy;
+    CombatStats stats;
+};
+
+//Compact copy of the board around a fight between a monster and the player
+struct SearchState {
+    //Window of the map the fight is simulated in; outside it counts as blocked
+    int originX = 0, originY = 0;
+    int width = MapWidth, height = MapHeight;
+    std::vector<char> blocked; //width*height; true where neither can move
+    Combatant monster;
+    Combatant player;
+};
+
+typedef std::chrono::steady_clock SearchClock;
+
+bool chooseLookaheadMove(const SearchState &state, ThreadPool *pool, std::mt19937 &seeder,
+			 int &dx, int &dy, int rollouts = 0,
+			 SearchClock::duration budget = std::chrono::milliseconds(LookaheadBudgetMs));
+#endif
@@ -0,0 +1,28 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+#include <cstdint>
+#include <string>
+#include "stringref.h"
+
+constexpr long MinMappedSize = 64 * 1024; //Smaller files are read instead
+
+class MappedFile {
+//Purpose: Read-only view of a whole file's contents, memory-mapped where the
+//    platform supports it and the file is big enough to be worth it (read
+//    into memory otherwise); unmapped when destroyed
+private:
+    const char *m_data;
+    std::size_t m_size;
+    bool m_open, m_mapped;
+    std::string m_contents; //Used when the file can't be mapped
+public:
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    bool isOpen() const { return m_open; }
+    StringRef contents() const { return StringRef(m_data, m_size); }
+};
+
+std::uint64_t fileStamp(const std::string &path);
+#endif
@@ -0,0 +1,16 @@
+#ifndef PATHING_H
+#define PATHING_H
+#include <functional>
+#include <vector>
+#include "bitboard.h"
+
+//A cell along a path
+struct PathStep {
+    int x, y;
+};
+
+//Shortest 8-way path from a start cell (not included) through cells not set
+//in blocked, to the nearest cell isGoal accepts; empty if none can be reached
+std::vector<PathStep> findPath(const Bitboard &blocked, int startX, int startY,
+			       const std::function<bool(int, int)> &isGoal);
+#endif
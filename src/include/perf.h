@@ -0,0 +1,67 @@
+#ifndef PERF_H
+#define PERF_H
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+constexpr int PerfWindow = 60; //Samples each rolling average covers
+constexpr int MemorySampleFrames = 30; //Frames between reads of memory use
+//Allocations are only counted (by replacing operator new) in builds with
+//-DRPG_COUNT_ALLOCATIONS; otherwise allocationCount() is always 0
+#ifdef RPG_COUNT_ALLOCATIONS
+constexpr bool CountingAllocations = true;
+#else
+constexpr bool CountingAllocations = false;
+#endif
+
+typedef std::chrono::steady_clock PerfClock;
+
+class RollingAverage {
+//Purpose: Average of the last PerfWindow samples added
+private:
+    std::array<double, PerfWindow> m_samples;
+    int m_count, m_next;
+    double m_sum;
+public:
+    RollingAverage() : m_samples{}, m_count(0), m_next(0), m_sum(0) {}
+    void add(double sample);
+    double average() const { return m_count == 0 ? 0 : m_sum / m_count; }
+};
+
+class PerfOverlay {
+//Purpose: Collects per-frame counters for the debug overlay (toggled in
+//    game) and keeps rolling averages of them. A frame ends at each present
+private:
+    bool m_visible;
+    PerfClock::time_point m_lastFrame;
+    //Counts since the last frame/turn ended
+    long m_cells, m_ticks, m_actorUpdates;
+    double m_turnMs;
+    std::uint64_t m_lastAllocations;
+    int m_frames;
+    long m_memoryKb;
+    double m_startupMs; //From main() to the first present
+    RollingAverage m_frameMs, m_turnTimeMs, m_actorsPerTick, m_cellsPerPresent,
+	m_allocationsPerFrame;
+public:
+    PerfOverlay();
+    void toggle() { m_visible = !m_visible; }
+    bool visible() const { return m_visible; }
+    inline void countCell() { ++m_cells; }
+    void countTick(int actorsUpdated, PerfClock::time_point start);
+    void countTurn();
+    void endFrame();
+    double frameMs() const { return m_frameMs.average(); }
+    double turnMs() const { return m_turnTimeMs.average(); }
+    double actorsPerTick() const { return m_actorsPerTick.average(); }
+    double cellsPerPresent() const { return m_cellsPerPresent.average(); }
+    double allocationsPerFrame() const { return m_allocationsPerFrame.average(); }
+    long memoryKb() const { return m_memoryKb; }
+    void setStartupMs(double ms) { m_startupMs = ms; }
+    double startupMs() const { return m_startupMs; }
+};
+
+std::uint64_t allocationCount();
+long currentMemoryKb();
+long peakMemoryKb();
+#endif
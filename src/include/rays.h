@@ -0,0 +1,95 @@
+#ifndef RAYS_H
+#define RAYS_H
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+constexpr int RayTableRadius = 16; //Rays this far (along each axis) are precomputed
+constexpr int MaxRayLength = INT16_MAX; //Longest ray (along each axis) a RayStep can hold
+
+//A cell along a ray, relative to the cell the ray starts from
+struct RayStep {
+    std::int16_t dx, dy;
+};
+
+class RayWalk {
+//Purpose: Steps along the Bresenham line from 0, 0 to dx, dy one cell at a
+//    time, moving diagonally whenever both axes are due a step, so a long
+//    ray never has to be stored
+private:
+    int m_dx, m_dy, m_spanX, m_spanY, m_stepX, m_stepY, m_error;
+    int m_x, m_y;
+public:
+    RayWalk(int dx = 0, int dy = 0);
+    bool done() const { return m_x == m_dx && m_y == m_dy; }
+    RayStep next();
+};
+
+//The cells on the Bresenham line from 0, 0 to dx, dy; the start is left
+//out and the end included
+std::vector<RayStep> traceRay(int dx, int dy);
+
+class RayTable {
+//Purpose: Holds the ray from a cell to every cell within RayTableRadius of
+//    it, computed once, so tracing a line (e.g. a line of fire, every time
+//    the cursor moves) is a walk along a stored list of steps
+private:
+    std::vector<RayStep> m_steps; //Every ray's steps, one ray after another
+    //Index into m_steps of each ray's first step, with one more at the end
+    std::vector<int> m_first;
+    static int rayIndex(int dx, int dy)
+    {
+	return (dy + RayTableRadius) * (2 * RayTableRadius + 1) + dx + RayTableRadius;
+    }
+public:
+    RayTable();
+    static bool covers(int dx, int dy)
+    {
+	return std::abs(dx) <= RayTableRadius && std::abs(dy) <= RayTableRadius;
+    }
+    const RayStep* begin(int dx, int dy) const { return m_steps.data() + m_first[rayIndex(dx, dy)]; }
+    const RayStep* end(int dx, int dy) const { return m_steps.data() + m_first[rayIndex(dx, dy) + 1]; }
+};
+
+//The table every Ray reads from, built on first use
+const RayTable& rayTable();
+
+class Ray {
+//Purpose: The steps of one ray, for range-for loops: read from the shared
+//    RayTable when it covers the ray, otherwise walked as the loop goes, so
+//    a loop that stops early (e.g. at the map's edge) only pays for the
+//    cells it reached. Rays longer than MaxRayLength have no steps
+public:
+    class Iterator {
+    private:
+	const RayStep *m_stored; //Next step of a RayTable ray; null if walked
+	RayWalk m_walk;
+	RayStep m_step;
+	bool m_finished; //Walked past the end
+    public:
+	Iterator(const RayStep *stored) : m_stored(stored), m_step{0, 0}, m_finished(false) {}
+	Iterator(const RayWalk &walk);
+	const RayStep& operator*() const { return m_stored ? *m_stored : m_step; }
+	const RayStep* operator->() const { return &**this; }
+	Iterator& operator++();
+	bool operator==(const Iterator &other) const
+	{
+	    return m_stored == other.m_stored && m_finished == other.m_finished;
+	}
+	bool operator!=(const Iterator &other) const { return !(*this == other); }
+    };
+private:
+    const RayStep *m_begin, *m_end; //Null if the ray is walked
+    RayWalk m_walk;
+public:
+    Ray(int dx, int dy);
+    Ray(const Ray&) = delete;
+    Ray& operator=(const Ray&) = delete;
+    static bool fits(int dx, int dy)
+    {
+	return std::abs(dx) <= MaxRayLength && std::abs(dy) <= MaxRayLength;
+    }
+    Iterator begin() const { return m_begin ? Iterator(m_begin) : Iterator(m_walk); }
+    Iterator end() const { return m_begin ? Iterator(m_end) : Iterator(RayWalk()); }
+};
+#endif
@@ -0,0 +1,38 @@
+#ifndef REGIONS_H
+#define REGIONS_H
+#include <vector>
+#include "bitboard.h"
+
+class RegionMap {
+//Purpose: Labels each open cell with the connected region (8-way, around
+//    walls) it belongs to, so whether one cell can reach another is a
+//    constant-time lookup instead of a search. Regions are found with a
+//    two-pass union-find labelling; opening a cell merges regions in place,
+//    while closing one (which might split a region) relabels the map
+private:
+    int m_width, m_height;
+    std::vector<int> m_labels; //Per cell, row-major; -1 for walls
+    //Region of each label; labels merged since the last full labelling
+    //share a region. Always flattened, so never more than one step
+    std::vector<int> m_regionOf;
+    int m_regionCount;
+    int label(int x, int y) const { return m_labels[y * m_width + x]; }
+public:
+    explicit RegionMap(const Bitboard &walls = Bitboard());
+    void relabel(const Bitboard &walls);
+    void opened(int x, int y);
+    //-1 for walls
+    int regionOf(int x, int y) const
+    {
+	int cell = label(x, y);
+	return cell < 0 ? -1 : m_regionOf[cell];
+    }
+    bool sameRegion(int x0, int y0, int x1, int y1) const
+    {
+	int region = regionOf(x0, y0);
+	return region >= 0 && region == regionOf(x1, y1);
+    }
+    int regionCount() const { return m_regionCount; }
+    int regionSize(int region) const;
+};
+#endif
@@ -0,0 +1,38 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+#include <iosfwd>
+#include <random>
+#include <vector>
+#include "display.h"
+
+constexpr int StressTurns = 20; //Player turns played per scenario
+constexpr double StressMaxSeconds = 30; //Scenarios still going after this stop early
+constexpr int StressDensity = 10; //Map tiles per generated actor/item
+constexpr int StressWallPercent = 5; //Chance a generated tile is a wall
+
+//A generated world to stress the board with
+struct ScenarioOptions {
+    int width, height;
+    int monsters, items;
+    unsigned int seed;
+    int wallPercent = StressWallPercent;
+    int turns = StressTurns;
+    double maxSeconds = StressMaxSeconds;
+};
+
+struct ScenarioReport {
+    ScenarioOptions options;
+    double setupSeconds; //Generating the map and building the board
+    int turnsPlayed;
+    bool timedOut; //Ran out of time before playing every turn
+    double turnsPerSecond;
+    double p50Ms, p99Ms; //Per-turn latency
+    long peakMemoryKb; //Peak resident set size of the process so far; -1 if unknown
+};
+
+ScenarioOptions scenarioOfSize(int entities, unsigned int seed);
+LevelMap generateMap(const ScenarioOptions &options, std::mt19937 &generator);
+ScenarioReport runScenario(const ScenarioOptions &options);
+void writeScenarioHeader(std::ostream &out);
+void writeScenarioReport(std::ostream &out, const ScenarioReport &report);
+#endif
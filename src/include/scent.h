@@ -0,0 +1,48 @@
+#ifndef SCENT_H
+#define SCENT_H
+#include <vector>
+#include "bitboard.h"
+
+constexpr float ScentSpread = 0.2f; //Share flowing to each open neighbour per step
+constexpr float ScentDecay = 0.995f; //Share left after each step
+constexpr int ScentStepsPerTurn = 4; //Spreading steps per player turn
+constexpr float ScentFloor = 1e-3f; //Scent fainter than this is gone
+
+//What was in a ScentMap, to put back later (e.g. when a turn is rewound)
+struct ScentSnapshot {
+    int minX = 0, minY = 0, maxX = -1, maxY = -1; //The rectangle the scent was in
+    std::vector<float> cells; //Its cells, row by row
+};
+
+class ScentMap {
+//Purpose: How strongly the player can be smelled in each cell. The player
+//    leaves scent where they stand every turn; each step it spreads to the
+//    open cells next to it (never into walls, so it carries along corridors)
+//    and fades, so monsters that can't see the player can track them by
+//    heading up the gradient. Spreading is a fixed stencil over the area
+//    the scent has reached, whatever the number of monsters. Cells are kept
+//    with a border of empty cells so the kernel's inner loop has no bounds
+//    checks or branches, and can be vectorized by the compiler
+private:
+    int m_width, m_height, m_stride; //m_stride = padded row length
+    std::vector<float> m_scent, m_next; //Padded, row-major; m_next is scratch
+    std::vector<float> m_open; //1 for open cells, 0 for walls and the border
+    std::vector<float> m_openNeighbours; //How many of the 4 neighbours are open
+    //Rectangle all the scent is in; it holds nothing if m_minX > m_maxX.
+    //Outside it, both buffers are always 0
+    int m_minX, m_minY, m_maxX, m_maxY;
+    int cell(int x, int y) const { return (y + 1) * m_stride + x + 1; }
+    void countOpenNeighbours(int x, int y);
+    void shrink();
+public:
+    explicit ScentMap(const Bitboard &walls = Bitboard());
+    void reset(const Bitboard &walls);
+    void setWall(int x, int y, bool wall);
+    void emit(int x, int y, float strength = 1.0f);
+    void spread();
+    float at(int x, int y) const { return m_scent[cell(x, y)]; }
+    bool strongestNeighbour(int x, int y, int &dx, int &dy) const;
+    ScentSnapshot save() const;
+    void restore(const ScentSnapshot &snapshot);
+};
+#endif
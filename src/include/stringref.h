@@ -0,0 +1,40 @@
+#ifndef STRING_REF_H
+#define STRING_REF_H
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+class StringRef {
+//Purpose: Non-owning view of a run of chars (e.g. part of a loaded file), so
+//    text can be split up and compared without copying it
+private:
+    const char *m_data;
+    std::size_t m_size;
+public:
+    StringRef() : m_data(nullptr), m_size(0) {}
+    StringRef(const char *data, std::size_t size) : m_data(data), m_size(size) {}
+    StringRef(const char *text) : m_data(text), m_size(std::strlen(text)) {}
+    const char* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    char operator[](std::size_t i) const { return m_data[i]; }
+    const char* begin() const { return m_data; }
+    const char* end() const { return m_data + m_size; }
+    //Sub-view from pos to the end, or of at most count chars
+    StringRef substr(std::size_t pos, std::size_t count = std::string::npos) const
+    {
+	return StringRef(m_data + pos, std::min(count, m_size - pos));
+    }
+    std::string str() const { return std::string(m_data, m_size); }
+};
+
+inline bool operator==(StringRef a, StringRef b)
+{
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size()) == 0;
+}
+
+inline bool operator!=(StringRef a, StringRef b)
+{
+    return !(a == b);
+}
+#endif
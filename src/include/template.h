@@ -1,9 +1,18 @@
 #ifndef OBJECT_TEMPLATE_H
 #define OBJECT_TEMPLATE_H
 #include <map>
+#include <vector>
 #include "actor.h"
 #include "item.h"
 
-std::map<char,Item> loadItemTemplates(const std::string &&path);
-std::map<char,Actor> loadMonsterTemplates(const std::string &&path);
+//A problem found while loading a template file; the line/section is skipped
+struct TemplateError {
+    int line; //0 if about the whole file
+    std::string message;
+};
+
+std::map<char,Item> loadItemTemplates(const std::string &&path,
+				      std::vector<TemplateError> *errors = nullptr);
+std::map<char,Actor> loadMonsterTemplates(const std::string &&path,
+					  std::vector<TemplateError> *errors = nullptr);
 #endif
@@ -0,0 +1,43 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+//Purpose: To run tasks on a fixed set of worker threads, letting the
+//    caller wait until every submitted task has finished. Each worker has
+//    its own queue; idle workers steal from the others' queues, so uneven
+//    tasks (e.g. games of different lengths) keep every core busy
+private:
+    struct WorkQueue {
+	std::mutex mutex;
+	std::deque<std::function<void()>> tasks;
+    };
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex; //Guards m_pending/m_stopping and sleeping workers
+    std::condition_variable m_hasTask;
+    std::condition_variable m_allDone;
+    std::atomic<int> m_queued; //Tasks sitting in queues
+    int m_pending; //Tasks submitted but not yet finished
+    bool m_stopping;
+    std::atomic<unsigned int> m_nextQueue;
+    bool takeTask(int worker, std::function<void()> &task);
+    void work(int worker);
+public:
+    explicit ThreadPool(int threadCount = defaultThreadCount());
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    static int defaultThreadCount();
+    int size() const { return m_workers.size(); }
+    void submit(std::function<void()> task);
+    void wait();
+};
+#endif
@@ -0,0 +1,37 @@
+#ifndef TILES_H
+#define TILES_H
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "display.h"
+#include "actor.h"
+
+//What a map cell's char stands for
+enum class TileKind : std::uint8_t { EMPTY, WALL, PLAYER, ITEM, MONSTER };
+
+struct TileInfo {
+    TileKind kind;
+    char glyph; //Char drawn for the tile
+    std::int16_t templateId; //Index into TileTable's monsters/items; -1 if none
+};
+
+class TileTable {
+//Purpose: Dense table of what each of the 256 chars means on the map, built
+//    once from the templates, so loading/movement/drawing/AI decide a tile
+//    with one indexed load instead of comparisons and std::map lookups
+private:
+    TileInfo m_info[256];
+    std::vector<Actor> m_monsters;
+    std::vector<Item> m_items;
+public:
+    TileTable();
+    void build(const std::map<char,Actor> &monsters, const std::map<char,Item> &items);
+    const TileInfo& operator[](char ch) const { return m_info[static_cast<unsigned char>(ch)]; }
+    bool isEmpty(char ch) const { return (*this)[ch].kind == TileKind::EMPTY; }
+    //nullptr if ch isn't a monster/item with a template
+    const Actor* monster(char ch) const;
+    const Item* item(char ch) const;
+    const std::vector<Actor>& monsters() const { return m_monsters; }
+    const std::vector<Item>& items() const { return m_items; }
+};
+#endif
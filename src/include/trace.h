@@ -0,0 +1,40 @@
+#ifndef TRACE_H
+#define TRACE_H
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+//Events a thread keeps before dropping new ones, bounding trace memory
+constexpr std::size_t MaxTraceEventsPerThread = 1 << 20;
+
+//Scoped trace macros: TRACE_SCOPE("name") records how long the rest of the
+//enclosing block takes. Compiled out entirely unless built with -DRPG_TRACE
+//(name must be a string literal; it is stored by pointer)
+#ifdef RPG_TRACE
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_FUNCTION() TRACE_SCOPE(__func__)
+#else
+#define TRACE_SCOPE(name) do {} while(false)
+#define TRACE_FUNCTION() do {} while(false)
+#endif
+
+class TraceScope {
+//Purpose: Records one complete trace event (name, start, duration) into the
+//    calling thread's own buffer when it goes out of scope; no locking
+private:
+    const char *m_name;
+    std::int64_t m_start;
+public:
+    explicit TraceScope(const char *name);
+    ~TraceScope();
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+std::size_t traceEventCount();
+void clearTrace();
+void writeChromeTrace(std::ostream &out);
+bool writeChromeTrace(const std::string &path);
+#endif
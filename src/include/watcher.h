@@ -0,0 +1,38 @@
+#ifndef WATCHER_H
+#define WATCHER_H
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "bundle.h"
+
+constexpr int WatchPollMs = 250; //How often the watcher checks for changes/stopping
+constexpr int WatchSettleMs = 50; //Quiet time after a change before re-parsing
+
+class TemplateWatcher {
+//Purpose: Watches the template INI files from a background thread (with
+//    inotify on Linux, polling elsewhere), re-parsing them there whenever
+//    either changes, so the game only has to swap in the result between turns
+private:
+    std::string m_monstersFile, m_itemsFile;
+    std::atomic<bool> m_stopping;
+    std::mutex m_mutex; //Guards m_ready
+    std::unique_ptr<TemplateSet> m_ready; //Latest parse not yet taken
+    //Watches are set up before the thread starts, so no change is missed
+    int m_inotifyFd; //-1 when polling stamps instead
+    std::uint64_t m_monstersStamp, m_itemsStamp;
+    std::thread m_thread;
+    void reload();
+    int startInotify() const;
+    void watchWithInotify();
+    void watchWithPolling();
+public:
+    TemplateWatcher(const std::string &monstersFile, const std::string &itemsFile);
+    ~TemplateWatcher();
+    TemplateWatcher(const TemplateWatcher&) = delete;
+    TemplateWatcher& operator=(const TemplateWatcher&) = delete;
+    std::unique_ptr<TemplateSet> take();
+};
+#endif
@@ -0,0 +1,14 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+#include <cstdint>
+#include "actor.h"
+
+//Keys for incrementally hashing board state. Each piece of state (a tile, an
+//Actor, an Item) has a 64-bit key; the board hash is the XOR of all keys, so
+//a change is applied by XORing out the old key and XORing in the new one.
+//Keys are derived by mixing rather than from a random table so that two runs
+//of the same session always produce the same hashes
+std::uint64_t tileKey(int x, int y, char ch);
+std::uint64_t actorKey(const Actor &actor);
+std::uint64_t itemKey(const Item &item);
+#endif
@@ -1,4 +1,5 @@
 #include "include/input.h"
+#include "include/trace.h"
 
 Input::Input(bool &running, Display &screen, GameBoard &board)
     : m_running(running), m_screen(screen), m_board(board)
@@ -10,6 +11,7 @@ Input::Input(bool &running, Display &screen, GameBoard &board)
    based on the event type (e.g. move player, resize screen) */
 bool Input::process()
 {
+    TRACE_SCOPE("Input::process");
     if(!m_screen.getInput()) {
 	return false;
     }
@@ -30,6 +32,10 @@ bool Input::process()
 	    //Redraws whole screen (useful for exiting inventory subscreen, etc.)
 	    m_board.redraw();
 	    break;
+	case TB_KEY_TAB:
+	    //Aim at the nearest monster in view, or the next nearest
+	    m_board.cycleTarget();
+	    break;
 	    //Basic player movement
 	case TB_KEY_ARROW_RIGHT:
 	    m_board.translatePlayer(1, 0);
@@ -62,6 +68,14 @@ bool Input::process()
 	    case 'D':
 		m_board.deequipItem(m_board.player());
 		break;
+	    case 'u':
+		m_board.rewindTurns();
+		break;
+	    case 'p':
+		//Toggle performance overlay
+		m_screen.perf().toggle();
+		m_board.redraw();
+		break;
 		//Controls for showing/moving cursor
 	    case 'r':
 		m_board.bindCursorMode(m_board.player(), &GameBoard::rangeAttack);
@@ -69,6 +83,12 @@ bool Input::process()
 	    case 't':
 		m_board.bindCursorMode(m_board.player(), &GameBoard::moveActor);
 		break;
+	    case 'g':
+		m_board.bindCursorMode(m_board.player(), &GameBoard::travelTo);
+		break;
+	    case 'o':
+		m_board.autoExplore();
+		break;
 	    }
 	}
 	break;
@@ -0,0 +1,208 @@
+#include "include/lookahead.h"
+#include "include/trace.h"
+#include <array>
+#include <cmath>
+
+//Monte Carlo tree search rooted at the monster's next move: each worker
+//runs its own UCB1 tree root (root parallelization) on its own generator,
+//playing out random fights with the real combat rules until time is up;
+//visit counts are then summed across workers to pick the move
+
+constexpr int DirectionCount = 8;
+constexpr int Directions[DirectionCount][2] = {
+    {-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}
+};
+//Chance that a rollout move is random rather than straight at the opponent
+constexpr int RolloutRandomPercent = 25;
+
+struct MoveStats {
+    int visits = 0;
+    double reward = 0;
+};
+typedef std::array<MoveStats, DirectionCount> RootStats;
+
+static bool isOpen(const SearchState &state, int x, int y)
+{
+    x -= state.originX;
+    y -= state.originY;
+    return x >= 0 && x < state.width && y >= 0 && y < state.height
+	&& !state.blocked[y * state.width + x];
+}
+
+/* Moves mover in given direction, or attacks other if it is there; returns
+   false if that direction is blocked*/
+static bool applyMove(const SearchState &state, Combatant &mover, Combatant &other,
+		      int direction, std::mt19937 &generator)
+{
+    int newX = mover.x + Directions[direction][0];
+    int newY = mover.y + Directions[direction][1];
+    if(newX == other.x && newY == other.y) {
+	int damage = 0;
+	if(resolveAttack(mover.stats, other.stats, damage, generator)) {
+	    other.health -= damage;
+	} else {
+	    mover.health -= damage;
+	}
+    } else if(isOpen(state, newX, newY)) {
+	mover.x = newX;
+	mover.y = newY;
+    } else {
+	return false;
+    }
+    --mover.energy;
+    return true;
+}
+
+/* Rollout policy: usually step towards the opponent, sometimes wander*/
+static void rolloutMove(const SearchState &state, Combatant &mover, Combatant &other,
+			std::mt19937 &generator)
+{
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_int_distribution<int> anyDirection(0, DirectionCount - 1);
+    if(percent(generator) >= RolloutRandomPercent) {
+	int dx = (other.x > mover.x) - (other.x < mover.x);
+	int dy = (other.y > mover.y) - (other.y < mover.y);
+	for(int i=0; i<DirectionCount; ++i) {
+	    if(Directions[i][0] == dx && Directions[i][1] == dy
+	       && applyMove(state, mover, other, i, generator)) {
+		return;
+	    }
+	}
+    }
+    //Try a few random directions before giving up the rest of the turn
+    for(int tries=0; tries<3; ++tries) {
+	if(applyMove(state, mover, other, anyDirection(generator), generator)) {
+	    return;
+	}
+    }
+    mover.energy = 0;
+}
+
+/* Scores a finished rollout from the monster's point of view on [0, 1]*/
+static double score(const SearchState &start, const Combatant &monster,
+		    const Combatant &player)
+{
+    if(monster.health <= 0) return 0;
+    if(player.health <= 0) return 1;
+    int dealt = start.player.health - player.health;
+    int taken = start.monster.health - monster.health;
+    return 0.5 + 0.5 * (dealt - taken) / static_cast<double>(dealt + taken + 1);
+}
+
+/* Plays out a fight after the monster takes the given first move*/
+static double rollout(const SearchState &state, int firstMove, std::mt19937 &generator)
+{
+    Combatant monster = state.monster;
+    Combatant player = state.player;
+    applyMove(state, monster, player, firstMove, generator);
+    bool monsterTurn = true;
+    for(int depth=1; depth<LookaheadDepth && monster.health > 0 && player.health > 0;
+	++depth) {
+	Combatant &mover = monsterTurn ? monster : player;
+	if(mover.energy <= 0) {
+	    //Turn passes to the other side, which starts with full energy
+	    monsterTurn = !monsterTurn;
+	    (monsterTurn ? monster : player).energy = TurnEnergy;
+	    continue;
+	}
+	rolloutMove(state, mover, monsterTurn ? player : monster, generator);
+    }
+    return score(state, monster, player);
+}
+
+/* Picks the move with the best upper confidence bound (UCB1); untried
+   moves always go first*/
+static int selectMove(const RootStats &stats, const bool (&legal)[DirectionCount],
+		      int totalVisits)
+{
+    int best = -1;
+    double bestBound = -1;
+    for(int i=0; i<DirectionCount; ++i) {
+	if(!legal[i]) continue;
+	if(stats[i].visits == 0) return i;
+	double bound = stats[i].reward / stats[i].visits
+	    + std::sqrt(2 * std::log(totalVisits) / stats[i].visits);
+	if(bound > bestBound) {
+	    bestBound = bound;
+	    best = i;
+	}
+    }
+    return best;
+}
+
+/* One worker's share of the search: keeps playing out fights from its own
+   root until the deadline, or for the given number of rollouts if not 0*/
+static void searchRoot(const SearchState &state, const bool (&legal)[DirectionCount],
+		       SearchClock::time_point deadline, int rollouts, unsigned int seed,
+		       RootStats &stats)
+{
+    TRACE_SCOPE("searchRoot");
+    std::mt19937 generator(seed);
+    int totalVisits = 0;
+    while(rollouts > 0 ? totalVisits < rollouts : SearchClock::now() < deadline) {
+	int move = selectMove(stats, legal, totalVisits);
+	stats[move].reward += rollout(state, move, generator);
+	++stats[move].visits;
+	++totalVisits;
+    }
+}
+
+/* Searches for the monster's best next step within the given time budget,
+   using every worker in the pool (or just the calling thread if pool is
+   nullptr); worker generators are seeded from seeder. Given a number of
+   rollouts, does that many instead, over LookaheadRoots roots, so the same
+   seeder always gives the same move. Returns false if the monster can't
+   move at all*/
+bool chooseLookaheadMove(const SearchState &state, ThreadPool *pool, std::mt19937 &seeder,
+			 int &dx, int &dy, int rollouts, SearchClock::duration budget)
+{
+    TRACE_SCOPE("chooseLookaheadMove");
+    bool legal[DirectionCount];
+    bool anyLegal = false;
+    for(int i=0; i<DirectionCount; ++i) {
+	int x = state.monster.x + Directions[i][0];
+	int y = state.monster.y + Directions[i][1];
+	legal[i] = (x == state.player.x && y == state.player.y) || isOpen(state, x, y);
+	anyLegal = anyLegal || legal[i];
+    }
+    if(!anyLegal) {
+	return false;
+    }
+
+    const SearchClock::time_point deadline = SearchClock::now() + budget;
+    //Timed searches have a root per worker; counted ones a fixed number
+    const int roots = rollouts > 0 ? LookaheadRoots : pool != nullptr ? pool->size() : 1;
+    const int perRoot = rollouts > 0 ? (rollouts + roots - 1) / roots : 0;
+    std::vector<RootStats> results(roots);
+    if(pool == nullptr) {
+	for(RootStats &stats : results) {
+	    searchRoot(state, legal, deadline, perRoot, seeder(), stats);
+	}
+    } else {
+	for(RootStats &stats : results) {
+	    unsigned int seed = seeder();
+	    pool->submit([&state, &legal, &stats, deadline, perRoot, seed] {
+		searchRoot(state, legal, deadline, perRoot, seed, stats);
+	    });
+	}
+	pool->wait();
+    }
+
+    //Most-visited move is the most robust choice
+    int best = -1;
+    int bestVisits = -1;
+    for(int i=0; i<DirectionCount; ++i) {
+	if(!legal[i]) continue;
+	int visits = 0;
+	for(const auto &workerStats : results) {
+	    visits += workerStats[i].visits;
+	}
+	if(visits > bestVisits) {
+	    bestVisits = visits;
+	    best = i;
+	}
+    }
+    dx = Directions[best][0];
+    dy = Directions[best][1];
+    return true;
+}
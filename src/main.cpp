@@ -30,12 +30,23 @@
 */
 #include "include/gameboard.h"
 #include "include/input.h"
+#include "include/agent.h"
+#include "include/batch.h"
+#include "include/scenario.h"
+#include "include/horde.h"
+#include "include/trace.h"
+#include "include/bundle.h"
 #include <iostream>
 #include <cstdio> //for FILENAME_MAX
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 #ifdef _WIN32
 #include <libloaderapi.h>
 #elif __APPLE__
 #include <mach-o/dyld.h>
+#elif __linux__
+#include <unistd.h>
 #endif
 
 /* Get absolute path to the directory that the executable is in*/
@@ -61,11 +72,32 @@ std::string getLocalDir()
     //Remove ., .. from path
     realpath(path, realPath);
     std::string dirPath(realPath);
+#elif __linux__
+    char path[FILENAME_MAX];
+    ssize_t size = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if(size < 0) {
+        std::cerr << "Error: Map file name could not be retrieved\n";
+        exit(1);
+    }
+    path[size] = '\0';
+    std::string dirPath(path);
 #endif
     //Strip off executable name from end ("/rpg2")
     return dirPath.substr(0, dirPath.size()-4);
 }
 
+#ifdef RPG_TRACE
+/* Saves everything traced this run for viewing in a trace viewer
+   (e.g. chrome://tracing or Perfetto)*/
+static void saveTrace()
+{
+    std::string path = getLocalDir() + "trace.json";
+    if(!writeChromeTrace(path)) {
+        std::cerr << "Error: could not write trace to " << path << "\n";
+    }
+}
+#endif
+
 /* Prompts user for integer value using given message*/
 static int inputSkill(int index, const std::string &message)
 {
@@ -162,20 +194,100 @@ static void skillSelection(Actor &actor)
     }
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+    PerfClock::time_point start = PerfClock::now();
+#ifdef RPG_TRACE
+    std::atexit(saveTrace);
+#endif
+    //Build step: compiles the INI templates into a bundle loaded at startup
+    if(argc > 1 && std::strcmp(argv[1], "--bundle-templates") == 0) {
+        std::vector<std::string> errors;
+        if(!writeTemplateBundle(getLocalDir(), errors)) {
+            for(const std::string &error : errors) {
+                std::cerr << "Error: " << error << "\n";
+            }
+            return 1;
+        }
+        return 0;
+    }
+    //Headless mode for programs playing the game; see runAgentProtocol()
+    if(argc > 1 && std::strcmp(argv[1], "--agent") == 0) {
+        std::string mapPath = argc > 2 ? argv[2] : getLocalDir() + "trapped-map.csv";
+        GameBoard board(nullptr, Actor(0, 0, "Player", PlayerTile, true), mapPath);
+        runAgentProtocol(board, std::cin, std::cout);
+        return 0;
+    }
+    //Plays many automated games in parallel, then reports how they went
+    if(argc > 2 && std::strcmp(argv[1], "--batch") == 0) {
+        BatchOptions options;
+        options.games = std::atoi(argv[2]);
+        options.mapPath = argc > 3 ? argv[3] : getLocalDir() + "trapped-map.csv";
+        options.seed = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : std::random_device{}();
+        writeReport(std::cout, runBatch(options));
+        return 0;
+    }
+    //Plays generated worlds of 10^3 actors/items up to the given size
+    //(default 10^6), reporting how the board scales
+    if(argc > 1 && std::strcmp(argv[1], "--stress") == 0) {
+        int maxEntities = argc > 2 ? std::atoi(argv[2]) : 1000000;
+        int turns = argc > 3 ? std::atoi(argv[3]) : StressTurns;
+        writeScenarioHeader(std::cout);
+        for(int entities = 1000; entities <= maxEntities; entities *= 10) {
+            ScenarioOptions options = scenarioOfSize(entities, entities);
+            options.turns = turns;
+            writeScenarioReport(std::cout, runScenario(options));
+        }
+        return 0;
+    }
+
+    //Horde mode: waves of monsters in an arena, up to the given number
+    //(default HordeMonsters) alive at once
+    bool hordeMode = argc > 1 && std::strcmp(argv[1], "--horde") == 0;
+    int hordeSize = HordeMonsters;
+    if(hordeMode && argc > 2) {
+        hordeSize = std::atoi(argv[2]);
+        if(hordeSize <= 0) {
+            std::cerr << "Usage: " << argv[0] << " --horde [monsters]\n"
+                      << "Error: the number of monsters must be above 0\n";
+            return 1;
+        }
+    }
+
     Actor player(0, 0, "Player", PlayerTile, true);
+    PerfClock::time_point creationStart = PerfClock::now();
     skillSelection(player);
+    //Character creation waits on the player, so it isn't part of startup time
+    PerfClock::duration creation = PerfClock::now() - creationStart;
 
     bool running = true;
     Display screen;
-    GameBoard board(screen, player, getLocalDir() + "trapped-map.csv");
-    Input device(running, screen, board);
+    std::unique_ptr<GameBoard> board;
+    std::unique_ptr<Horde> horde;
+    if(hordeMode) {
+        HordeOptions options = hordeOfSize(hordeSize, std::random_device{}());
+        std::mt19937 generator(options.seed);
+        player.addHealth(HordePlayerHealth);
+        board.reset(new GameBoard(&screen, player, generateArena(options, generator),
+                                  options.seed));
+        horde.reset(new Horde(*board, options));
+    } else {
+        board.reset(new GameBoard(&screen, player, getLocalDir() + "trapped-map.csv"));
+    }
+    Input device(running, screen, *board);
+    board->present();
+    std::chrono::duration<double, std::milli> startup = PerfClock::now() - start - creation;
+    screen.perf().setStartupMs(startup.count());
+    //Edits to the template INIs take effect at the start of the next turn
+    board->watchTemplates(monstersPath(getLocalDir()), itemsPath(getLocalDir()));
 
     //Start main game loop
     while(running && device.process()) {
-        board.updateActors();
-        board.present();
+        board->updateActors();
+        if(horde) {
+            horde->update();
+        }
+        board->present();
     }
 
     return 0;
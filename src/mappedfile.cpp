@@ -0,0 +1,86 @@
+#include "include/mappedfile.h"
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string &path)
+    : m_data(""), m_size(0), m_open(false), m_mapped(false)
+{
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+	return;
+    }
+    struct stat info;
+    if(fstat(fd, &info) == 0) {
+	if(info.st_size >= MinMappedSize) {
+	    void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	    if(data != MAP_FAILED) {
+		m_data = static_cast<const char*>(data);
+		m_size = info.st_size;
+		m_mapped = true;
+		m_open = true;
+	    }
+	} else {
+	    //Mapping costs more than it saves for small files, so just read them
+	    m_contents.resize(info.st_size);
+	    std::size_t done = 0;
+	    ssize_t got = 1;
+	    while(done < m_contents.size() && got > 0) {
+		got = read(fd, &m_contents[done], m_contents.size() - done);
+		done += got > 0 ? got : 0;
+	    }
+	    m_contents.resize(done);
+	    m_data = m_contents.data();
+	    m_size = m_contents.size();
+	    m_open = got >= 0;
+	}
+    }
+    close(fd);
+    if(m_open) {
+	return;
+    }
+#endif
+    //Can't map it (or no mmap); read it all in instead
+    std::ifstream file(path, std::ios::binary);
+    if(!file) {
+	return;
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    m_contents = contents.str();
+    m_data = m_contents.data();
+    m_size = m_contents.size();
+    m_open = true;
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if(m_mapped) {
+	munmap(const_cast<char*>(m_data), m_size);
+    }
+#endif
+}
+
+/* Identifies a file's current version by its size and modification time
+   (cheaper than reading it); 0 if it doesn't exist*/
+std::uint64_t fileStamp(const std::string &path)
+{
+    struct stat info;
+    if(stat(path.c_str(), &info) != 0) {
+	return 0;
+    }
+    std::uint64_t modified = static_cast<std::uint64_t>(info.st_mtime) * 1000000000ull;
+#ifdef __linux__
+    modified += info.st_mtim.tv_nsec;
+#elif __APPLE__
+    modified += info.st_mtimespec.tv_nsec;
+#endif
+    return (modified * 1099511628211ull) ^ static_cast<std::uint64_t>(info.st_size);
+}
@@ -0,0 +1,47 @@
+#include "include/pathing.h"
+
+/* Orthogonal neighbours first, so paths don't zig-zag diagonally when a
+   straight line is as short*/
+static const int StepDx[] = {1, -1, 0, 0, 1, 1, -1, -1};
+static const int StepDy[] = {0, 0, 1, -1, 1, -1, 1, -1};
+
+/* Breadth-first search outward from the start, remembering where each cell
+   was reached from; the first goal cell dequeued is the nearest, and its
+   path is read back through those links*/
+std::vector<PathStep> findPath(const Bitboard &blocked, int startX, int startY,
+			       const std::function<bool(int, int)> &isGoal)
+{
+    const int width = blocked.width();
+    const int height = blocked.height();
+    std::vector<int> cameFrom(width * height, -1);
+    std::vector<int> queue;
+    queue.reserve(width * height);
+    const int start = startY * width + startX;
+    cameFrom[start] = start;
+    queue.push_back(start);
+    for(std::size_t next=0; next<queue.size(); ++next) {
+	int cell = queue[next];
+	int x = cell % width;
+	int y = cell / width;
+	if(cell != start && isGoal(x, y)) {
+	    std::vector<PathStep> path;
+	    for(; cell != start; cell = cameFrom[cell]) {
+		path.push_back(PathStep{cell % width, cell / width});
+	    }
+	    return std::vector<PathStep>(path.rbegin(), path.rend());
+	}
+	for(int i=0; i<8; ++i) {
+	    int nextX = x + StepDx[i];
+	    int nextY = y + StepDy[i];
+	    if(nextX < 0 || nextX >= width || nextY < 0 || nextY >= height) {
+		continue;
+	    }
+	    int neighbour = nextY * width + nextX;
+	    if(cameFrom[neighbour] < 0 && !blocked.test(nextX, nextY)) {
+		cameFrom[neighbour] = cell;
+		queue.push_back(neighbour);
+	    }
+	}
+    }
+    return std::vector<PathStep>();
+}
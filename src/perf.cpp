@@ -0,0 +1,133 @@
+#include "include/perf.h"
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#ifdef RPG_COUNT_ALLOCATIONS
+//Every allocation in the process goes through here so the overlay can
+//count them; relaxed since only the total matters
+static std::atomic<std::uint64_t> allocations(0);
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *memory = std::malloc(size == 0 ? 1 : size);
+    if(!memory) {
+	throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+std::uint64_t allocationCount()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+#else
+//Normal builds keep the stock allocator, and count nothing
+std::uint64_t allocationCount()
+{
+    return 0;
+}
+#endif
+
+void RollingAverage::add(double sample)
+{
+    if(m_count == PerfWindow) {
+	m_sum -= m_samples[m_next];
+    } else {
+	++m_count;
+    }
+    m_samples[m_next] = sample;
+    m_sum += sample;
+    m_next = (m_next + 1) % PerfWindow;
+}
+
+PerfOverlay::PerfOverlay()
+    : m_visible(false), m_lastFrame(PerfClock::now()), m_cells(0), m_ticks(0),
+      m_actorUpdates(0), m_turnMs(0), m_lastAllocations(allocationCount()),
+      m_frames(0), m_memoryKb(currentMemoryKb()), m_startupMs(0)
+{
+}
+
+/* Called after each tick of updating actors that started at start*/
+void PerfOverlay::countTick(int actorsUpdated, PerfClock::time_point start)
+{
+    std::chrono::duration<double, std::milli> elapsed = PerfClock::now() - start;
+    m_turnMs += elapsed.count();
+    m_actorUpdates += actorsUpdated;
+    ++m_ticks;
+}
+
+/* Called when the player's turn starts; a turn's time is what its ticks took*/
+void PerfOverlay::countTurn()
+{
+    m_turnTimeMs.add(m_turnMs);
+    m_turnMs = 0;
+}
+
+/* Called on each present; samples everything counted since the last one*/
+void PerfOverlay::endFrame()
+{
+    PerfClock::time_point now = PerfClock::now();
+    std::chrono::duration<double, std::milli> elapsed = now - m_lastFrame;
+    m_lastFrame = now;
+    m_frameMs.add(elapsed.count());
+    m_cellsPerPresent.add(m_cells);
+    m_cells = 0;
+    if(m_ticks > 0) {
+	m_actorsPerTick.add(static_cast<double>(m_actorUpdates) / m_ticks);
+	m_actorUpdates = 0;
+	m_ticks = 0;
+    }
+    std::uint64_t allocated = allocationCount();
+    m_allocationsPerFrame.add(allocated - m_lastAllocations);
+    m_lastAllocations = allocated;
+    //Reading memory use is a system call or file read, so not every frame
+    if(++m_frames % MemorySampleFrames == 0) {
+	m_memoryKb = currentMemoryKb();
+    }
+}
+
+/* Resident set size of this process in kilobytes, or -1 where it can't be
+   measured; falls back to the peak where only that is available*/
+long currentMemoryKb()
+{
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0;
+    long residentPages = 0;
+    if(statm >> pages >> residentPages) {
+	return residentPages * (sysconf(_SC_PAGESIZE) / 1024);
+    }
+#endif
+    return peakMemoryKb();
+}
+
+/* Peak resident set size of this process in kilobytes, or -1 where it
+   can't be measured*/
+long peakMemoryKb()
+{
+#ifdef _WIN32
+    return -1;
+#else
+    rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0) {
+	return -1;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; //In bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
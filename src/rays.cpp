@@ -0,0 +1,84 @@
+#include "include/rays.h"
+
+RayWalk::RayWalk(int dx, int dy)
+    : m_dx(dx), m_dy(dy), m_spanX(std::abs(dx)), m_spanY(-std::abs(dy)),
+      m_stepX(dx > 0 ? 1 : -1), m_stepY(dy > 0 ? 1 : -1), m_error(m_spanX + m_spanY), m_x(0), m_y(0)
+{
+}
+
+/* Moves on to the ray's next cell with Bresenham's algorithm and returns
+   it; only to be called while not done()*/
+RayStep RayWalk::next()
+{
+    int doubled = 2 * m_error;
+    if(doubled >= m_spanY) {
+	m_error += m_spanY;
+	m_x += m_stepX;
+    }
+    if(doubled <= m_spanX) {
+	m_error += m_spanX;
+	m_y += m_stepY;
+    }
+    return RayStep{static_cast<std::int16_t>(m_x), static_cast<std::int16_t>(m_y)};
+}
+
+std::vector<RayStep> traceRay(int dx, int dy)
+{
+    std::vector<RayStep> steps;
+    for(RayWalk walk(dx, dy); !walk.done(); ) {
+	steps.push_back(walk.next());
+    }
+    return steps;
+}
+
+RayTable::RayTable()
+{
+    const int side = 2 * RayTableRadius + 1;
+    m_first.reserve(side * side + 1);
+    for(int dy=-RayTableRadius; dy<=RayTableRadius; ++dy) {
+	for(int dx=-RayTableRadius; dx<=RayTableRadius; ++dx) {
+	    m_first.push_back(m_steps.size());
+	    std::vector<RayStep> ray = traceRay(dx, dy);
+	    m_steps.insert(m_steps.end(), ray.begin(), ray.end());
+	}
+    }
+    m_first.push_back(m_steps.size());
+}
+
+const RayTable& rayTable()
+{
+    static const RayTable table;
+    return table;
+}
+
+/* Starts walking a ray the table doesn't cover; a ray with no steps
+   starts out finished*/
+Ray::Iterator::Iterator(const RayWalk &walk)
+    : m_stored(nullptr), m_walk(walk), m_step{0, 0}, m_finished(m_walk.done())
+{
+    if(!m_finished) {
+	m_step = m_walk.next();
+    }
+}
+
+Ray::Iterator& Ray::Iterator::operator++()
+{
+    if(m_stored) {
+	++m_stored;
+    } else if(m_walk.done()) {
+	m_finished = true;
+    } else {
+	m_step = m_walk.next();
+    }
+    return *this;
+}
+
+Ray::Ray(int dx, int dy) : m_begin(nullptr), m_end(nullptr)
+{
+    if(RayTable::covers(dx, dy)) {
+	m_begin = rayTable().begin(dx, dy);
+	m_end = rayTable().end(dx, dy);
+    } else if(fits(dx, dy)) {
+	m_walk = RayWalk(dx, dy);
+    }
+}
@@ -0,0 +1,115 @@
+#include "include/regions.h"
+
+/* Neighbours already visited by a row-major scan: W, NW, N, NE*/
+static const int ScannedDx[] = {-1, -1, 0, 1};
+static const int ScannedDy[] = {0, -1, -1, -1};
+
+static int findRoot(std::vector<int> &parent, int label)
+{
+    while(parent[label] != label) {
+	parent[label] = parent[parent[label]];
+	label = parent[label];
+    }
+    return label;
+}
+
+RegionMap::RegionMap(const Bitboard &walls)
+{
+    relabel(walls);
+}
+
+/* Labels every open cell from scratch: the first pass gives each cell the
+   label of a scanned neighbour (or a new one), noting which labels touch;
+   the second maps each label to a dense region number*/
+void RegionMap::relabel(const Bitboard &walls)
+{
+    m_width = walls.width();
+    m_height = walls.height();
+    m_labels.assign(m_width * m_height, -1);
+    std::vector<int> parent;
+    for(int y=0; y<m_height; ++y) {
+	for(int x=0; x<m_width; ++x) {
+	    if(walls.test(x, y)) {
+		continue;
+	    }
+	    int &cell = m_labels[y * m_width + x];
+	    for(int i=0; i<4; ++i) {
+		int nx = x + ScannedDx[i], ny = y + ScannedDy[i];
+		if(nx < 0 || ny < 0 || nx >= m_width || label(nx, ny) < 0) {
+		    continue;
+		}
+		int root = findRoot(parent, label(nx, ny));
+		if(cell < 0) {
+		    cell = root;
+		} else if(root != findRoot(parent, cell)) {
+		    parent[root] = findRoot(parent, cell);
+		}
+	    }
+	    if(cell < 0) {
+		cell = parent.size();
+		parent.push_back(cell);
+	    }
+	}
+    }
+    m_regionOf.assign(parent.size(), -1);
+    m_regionCount = 0;
+    std::vector<int> regionOfRoot(parent.size(), -1);
+    for(std::size_t i=0; i<parent.size(); ++i) {
+	int root = findRoot(parent, i);
+	if(regionOfRoot[root] < 0) {
+	    regionOfRoot[root] = m_regionCount++;
+	}
+	m_regionOf[i] = regionOfRoot[root];
+    }
+}
+
+/* Updates the regions for a wall cell that's now open, joining it with (and
+   merging) the regions around it*/
+void RegionMap::opened(int x, int y)
+{
+    if(label(x, y) >= 0) {
+	return;
+    }
+    int joined = -1;
+    for(int dy=-1; dy<=1; ++dy) {
+	for(int dx=-1; dx<=1; ++dx) {
+	    int nx = x + dx, ny = y + dy;
+	    if(nx < 0 || ny < 0 || nx >= m_width || ny >= m_height || regionOf(nx, ny) < 0) {
+		continue;
+	    }
+	    int region = regionOf(nx, ny);
+	    if(joined < 0) {
+		joined = region;
+	    } else if(region != joined) {
+		//Fold region into joined; the region number left unused is
+		//filled by moving the last region into it
+		int last = m_regionCount - 1;
+		for(int &each : m_regionOf) {
+		    if(each == region) each = joined;
+		}
+		if(region != last) {
+		    for(int &each : m_regionOf) {
+			if(each == last) each = region;
+		    }
+		    if(joined == last) joined = region;
+		}
+		--m_regionCount;
+	    }
+	}
+    }
+    if(joined < 0) {
+	joined = m_regionCount++;
+    }
+    m_labels[y * m_width + x] = m_regionOf.size();
+    m_regionOf.push_back(joined);
+}
+
+/* Counts the open cells in a region*/
+int RegionMap::regionSize(int region) const
+{
+    int size = 0;
+    for(int cell : m_labels) {
+	size += cell >= 0 && m_regionOf[cell] == region;
+    }
+    return size;
+}
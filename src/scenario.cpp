@@ -0,0 +1,168 @@
+#include "include/scenario.h"
+#include "include/gameboard.h"
+#include "include/perf.h"
+#include "include/regions.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+//Generated worlds only use plain monsters, so no turn is spent searching
+constexpr char ScenarioMonsters[] = "ImdB";
+constexpr int PlayerBonusHealth = 1000000; //Player outlives any scenario
+//Ticks between checks of the scenario's deadline
+constexpr long DeadlineCheckTicks = 1024;
+
+/* Options for a square world holding about the given number of actors and
+   items (half each), at StressDensity tiles per entity*/
+ScenarioOptions scenarioOfSize(int entities, unsigned int seed)
+{
+    int side = std::sqrt(static_cast<double>(entities) * StressDensity);
+    ScenarioOptions options;
+    options.width = std::max(side, MapWidth);
+    options.height = std::max(side, MapHeight);
+    options.monsters = entities / 2;
+    options.items = entities - options.monsters;
+    options.seed = seed;
+    return options;
+}
+
+/* Picks random interior tiles until one is free and in the given region;
+   the region must have room*/
+static void placeRandomly(LevelMap &map, const RegionMap &regions, int region, char ch,
+			  std::mt19937 &generator)
+{
+    std::uniform_int_distribution<int> xDist(1, map.width() - 2);
+    std::uniform_int_distribution<int> yDist(1, map.height() - 2);
+    int x, y;
+    do {
+	x = xDist(generator);
+	y = yDist(generator);
+    } while(map[y][x] != 0 || regions.regionOf(x, y) != region);
+    map[y][x] = ch;
+}
+
+/* Builds a walled map with scattered walls, the player in (or, if walled
+   in there, nearest) the middle and monsters/items at random empty tiles
+   the player can reach*/
+LevelMap generateMap(const ScenarioOptions &options, std::mt19937 &generator)
+{
+    LevelMap map(options.width, options.height);
+    std::uniform_int_distribution<int> percent(0, 99);
+    for(int row=0; row<map.height(); ++row) {
+	for(int col=0; col<map.width(); ++col) {
+	    bool edge = row == 0 || col == 0 || row == map.height() - 1
+		|| col == map.width() - 1;
+	    if(edge || percent(generator) < options.wallPercent) {
+		map[row][col] = WallTile;
+	    }
+	}
+    }
+    //Everything goes in the largest region, so nothing is walled off
+    RegionMap regions(Bitboard::fromLayer(map));
+    std::vector<int> sizes(regions.regionCount(), 0);
+    for(int row=0; row<map.height(); ++row) {
+	for(int col=0; col<map.width(); ++col) {
+	    if(regions.regionOf(col, row) >= 0) ++sizes[regions.regionOf(col, row)];
+	}
+    }
+    int largest = std::max_element(sizes.begin(), sizes.end()) - sizes.begin();
+    int playerX = 0, playerY = 0, nearest = -1;
+    for(int row=0; row<map.height(); ++row) {
+	for(int col=0; col<map.width(); ++col) {
+	    int distance = std::abs(col - map.width() / 2) + std::abs(row - map.height() / 2);
+	    if(regions.regionOf(col, row) == largest && (nearest < 0 || distance < nearest)) {
+		playerX = col;
+		playerY = row;
+		nearest = distance;
+	    }
+	}
+    }
+    map[playerY][playerX] = PlayerTile;
+
+    std::uniform_int_distribution<int> kind(0, sizeof(ScenarioMonsters) - 2);
+    for(int i=0; i<options.monsters; ++i) {
+	placeRandomly(map, regions, largest, ScenarioMonsters[kind(generator)], generator);
+    }
+    for(int i=0; i<options.items; ++i) {
+	placeRandomly(map, regions, largest, ItemTile, generator);
+    }
+    return map;
+}
+
+/* Builds the scenario's world and plays its turns headlessly, the player
+   waiting each turn while every monster acts, timing each turn. Stops early
+   once options.maxSeconds of play have passed, even in the middle of a turn*/
+ScenarioReport runScenario(const ScenarioOptions &options)
+{
+    typedef std::chrono::steady_clock Clock;
+    ScenarioReport report{options, 0, 0, false, 0, 0, 0, -1};
+    auto start = Clock::now();
+    std::mt19937 generator(options.seed);
+    Actor player(0, 0, "Player", PlayerTile, true);
+    player.addHealth(PlayerBonusHealth);
+    GameBoard board(nullptr, player, generateMap(options, generator), options.seed);
+    //Measure the board itself, not the search pool
+    board.setSearchThreads(0);
+    auto playStart = Clock::now();
+    std::chrono::duration<double> setup = playStart - start;
+    report.setupSeconds = setup.count();
+
+    auto deadline = playStart + std::chrono::duration_cast<Clock::duration>(
+	std::chrono::duration<double>(options.maxSeconds));
+    std::vector<double> latencies;
+    while(report.turnsPlayed < options.turns && !report.timedOut) {
+	auto turnStart = Clock::now();
+	board.endTurn(board.player());
+	long ticks = 0;
+	do {
+	    board.updateActors();
+	    if(++ticks % DeadlineCheckTicks == 0 && Clock::now() > deadline) {
+		report.timedOut = true;
+		break;
+	    }
+	} while(!(board.player().isTurn() && board.player().getEnergy() > 0));
+	if(report.timedOut) {
+	    break;
+	}
+	std::chrono::duration<double, std::milli> turnTime = Clock::now() - turnStart;
+	latencies.push_back(turnTime.count());
+	++report.turnsPlayed;
+	report.timedOut = report.turnsPlayed < options.turns && Clock::now() > deadline;
+    }
+    std::chrono::duration<double> played = Clock::now() - playStart;
+
+    if(!latencies.empty()) {
+	report.turnsPerSecond = latencies.size() / played.count();
+	std::sort(latencies.begin(), latencies.end());
+	report.p50Ms = latencies[(latencies.size() - 1) / 2];
+	report.p99Ms = latencies[(latencies.size() - 1) * 99 / 100];
+    }
+    report.peakMemoryKb = peakMemoryKb();
+    return report;
+}
+
+void writeScenarioHeader(std::ostream &out)
+{
+    out << std::setw(11) << "map" << std::setw(9) << "monsters" << std::setw(9) << "items"
+	<< std::setw(9) << "setup s" << std::setw(7) << "turns" << std::setw(11) << "turns/sec"
+	<< std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "peak MB"
+	<< "\n";
+}
+
+void writeScenarioReport(std::ostream &out, const ScenarioReport &report)
+{
+    const ScenarioOptions &options = report.options;
+    out << std::fixed << std::setprecision(2);
+    out << std::setw(11) << std::to_string(options.width) + "x" + std::to_string(options.height)
+	<< std::setw(9) << options.monsters << std::setw(9) << options.items
+	<< std::setw(9) << report.setupSeconds << std::setw(7) << report.turnsPlayed
+	<< std::setw(11) << report.turnsPerSecond << std::setw(10) << report.p50Ms
+	<< std::setw(10) << report.p99Ms << std::setw(10) << report.peakMemoryKb / 1024.0;
+    if(report.timedOut) {
+	out << "  (timed out after " << options.maxSeconds << "s)";
+    }
+    //Scenarios are slow; show each as soon as it's done
+    out << std::endl;
+}
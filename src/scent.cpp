@@ -0,0 +1,207 @@
+#include "include/scent.h"
+#include "include/trace.h"
+#include <algorithm>
+
+ScentMap::ScentMap(const Bitboard &walls)
+{
+    reset(walls);
+}
+
+/* Clears all scent and takes on a (new) map's walls*/
+void ScentMap::reset(const Bitboard &walls)
+{
+    m_width = walls.width();
+    m_height = walls.height();
+    m_stride = m_width + 2;
+    const int cells = m_stride * (m_height + 2);
+    m_scent.assign(cells, 0.0f);
+    m_next.assign(cells, 0.0f);
+    m_open.assign(cells, 0.0f);
+    m_openNeighbours.assign(cells, 0.0f);
+    for(int y=0; y<m_height; ++y) {
+	for(int x=0; x<m_width; ++x) {
+	    m_open[cell(x, y)] = walls.test(x, y) ? 0.0f : 1.0f;
+	}
+    }
+    for(int y=0; y<m_height; ++y) {
+	for(int x=0; x<m_width; ++x) {
+	    countOpenNeighbours(x, y);
+	}
+    }
+    m_minX = m_minY = 0;
+    m_maxX = m_maxY = -1;
+}
+
+void ScentMap::countOpenNeighbours(int x, int y)
+{
+    int at = cell(x, y);
+    m_openNeighbours[at] = m_open[at - 1] + m_open[at + 1]
+	+ m_open[at - m_stride] + m_open[at + m_stride];
+}
+
+/* Builds or removes a wall; walls hold no scent*/
+void ScentMap::setWall(int x, int y, bool wall)
+{
+    int at = cell(x, y);
+    m_open[at] = wall ? 0.0f : 1.0f;
+    if(wall) {
+	m_scent[at] = 0.0f;
+    }
+    countOpenNeighbours(x, y);
+    if(x > 0) countOpenNeighbours(x - 1, y);
+    if(x < m_width - 1) countOpenNeighbours(x + 1, y);
+    if(y > 0) countOpenNeighbours(x, y - 1);
+    if(y < m_height - 1) countOpenNeighbours(x, y + 1);
+}
+
+/* Leaves scent in an open cell, at least as strong as given*/
+void ScentMap::emit(int x, int y, float strength)
+{
+    int at = cell(x, y);
+    if(m_open[at] == 0.0f) {
+	return;
+    }
+    m_scent[at] = std::max(m_scent[at], strength);
+    if(m_minX > m_maxX) {
+	m_minX = m_maxX = x;
+	m_minY = m_maxY = y;
+    } else {
+	m_minX = std::min(m_minX, x);
+	m_maxX = std::max(m_maxX, x);
+	m_minY = std::min(m_minY, y);
+	m_maxY = std::max(m_maxY, y);
+    }
+}
+
+/* One turn of spreading/fading. Each step, every open cell exchanges a
+   share of the difference with each open neighbour (walls and the border
+   hold 0, so they drop out of the neighbour sum), then fades*/
+void ScentMap::spread()
+{
+    TRACE_SCOPE("ScentMap::spread");
+    if(m_minX > m_maxX) {
+	return;
+    }
+    for(int step=0; step<ScentStepsPerTurn; ++step) {
+	//Scent reaches one cell further each step
+	m_minX = std::max(0, m_minX - 1);
+	m_minY = std::max(0, m_minY - 1);
+	m_maxX = std::min(m_width - 1, m_maxX + 1);
+	m_maxY = std::min(m_height - 1, m_maxY + 1);
+	const int length = m_maxX - m_minX + 1;
+	for(int y=m_minY; y<=m_maxY; ++y) {
+	    const int start = cell(m_minX, y);
+	    const float *centre = &m_scent[start];
+	    const float *up = centre - m_stride;
+	    const float *down = centre + m_stride;
+	    const float *open = &m_open[start];
+	    const float *neighbours = &m_openNeighbours[start];
+	    float *out = &m_next[start];
+	    for(int i=0; i<length; ++i) {
+		float sum = up[i] + down[i] + centre[i - 1] + centre[i + 1];
+		float value = open[i] * ScentDecay
+		    * (centre[i] + ScentSpread * (sum - centre[i] * neighbours[i]));
+		out[i] = value < ScentFloor ? 0.0f : value;
+	    }
+	}
+	m_scent.swap(m_next);
+    }
+    shrink();
+}
+
+/* Fits the rectangle back around the cells that still hold scent, so
+   the area spread over stays near the player rather than growing to
+   cover the whole map*/
+void ScentMap::shrink()
+{
+    int minX = m_width, minY = m_height, maxX = -1, maxY = -1;
+    for(int y=m_minY; y<=m_maxY; ++y) {
+	const float *row = &m_scent[cell(0, y)];
+	int first = m_minX;
+	while(first <= m_maxX && row[first] == 0.0f) {
+	    ++first;
+	}
+	if(first > m_maxX) {
+	    continue;
+	}
+	int last = m_maxX;
+	while(row[last] == 0.0f) {
+	    --last;
+	}
+	minX = std::min(minX, first);
+	maxX = std::max(maxX, last);
+	minY = std::min(minY, y);
+	maxY = y;
+    }
+    //m_next is scratch, but still has to be 0 outside the new rectangle
+    for(int y=m_minY; y<=m_maxY; ++y) {
+	std::fill_n(&m_next[cell(m_minX, y)], m_maxX - m_minX + 1, 0.0f);
+    }
+    m_minX = minX;
+    m_minY = minY;
+    m_maxX = maxX;
+    m_maxY = maxY;
+}
+
+/* Finds the neighbouring open cell (8-way) with the strongest scent, if
+   any is stronger than this cell's*/
+bool ScentMap::strongestNeighbour(int x, int y, int &dx, int &dy) const
+{
+    float best = at(x, y);
+    bool found = false;
+    for(int stepY=-1; stepY<=1; ++stepY) {
+	for(int stepX=-1; stepX<=1; ++stepX) {
+	    int nextX = x + stepX, nextY = y + stepY;
+	    if(nextX < 0 || nextX >= m_width || nextY < 0 || nextY >= m_height) {
+		continue;
+	    }
+	    float scent = at(nextX, nextY);
+	    if(scent > best) {
+		best = scent;
+		dx = stepX;
+		dy = stepY;
+		found = true;
+	    }
+	}
+    }
+    return found;
+}
+
+/* Copies out the rectangle holding scent; only that much is kept*/
+ScentSnapshot ScentMap::save() const
+{
+    ScentSnapshot snapshot;
+    snapshot.minX = m_minX;
+    snapshot.minY = m_minY;
+    snapshot.maxX = m_maxX;
+    snapshot.maxY = m_maxY;
+    if(m_minX <= m_maxX) {
+	const int length = m_maxX - m_minX + 1;
+	snapshot.cells.reserve(length * (m_maxY - m_minY + 1));
+	for(int y=m_minY; y<=m_maxY; ++y) {
+	    const float *row = &m_scent[cell(m_minX, y)];
+	    snapshot.cells.insert(snapshot.cells.end(), row, row + length);
+	}
+    }
+    return snapshot;
+}
+
+/* Puts back scent saved from this map (same size and walls)*/
+void ScentMap::restore(const ScentSnapshot &snapshot)
+{
+    for(int y=m_minY; y<=m_maxY; ++y) {
+	std::fill_n(&m_scent[cell(m_minX, y)], m_maxX - m_minX + 1, 0.0f);
+    }
+    m_minX = snapshot.minX;
+    m_minY = snapshot.minY;
+    m_maxX = snapshot.maxX;
+    m_maxY = snapshot.maxY;
+    if(m_minX > m_maxX) {
+	return;
+    }
+    const int length = m_maxX - m_minX + 1;
+    const float *from = snapshot.cells.data();
+    for(int y=m_minY; y<=m_maxY; ++y, from += length) {
+	std::copy(from, from + length, &m_scent[cell(m_minX, y)]);
+    }
+}
@@ -1,143 +1,316 @@
 #include "include/template.h"
-#include <fstream>
+#include "include/mappedfile.h"
+#include "include/trace.h"
+#include <limits>
 
-static std::string::size_type findSplit(const std::string line)
+//Every key allowed in a template file
+enum class TemplateKey {
+    CHAR, NAME, ENERGY, HEALTH, CARRY_WEIGHT, MAX_CARRY_WEIGHT, LEVEL, LEVEL_PROGRESS,
+    STRENGTH, CUNNING, AGILITY, EDUCATION, SIDEARM_SKILL, LONGARM_SKILL, MELEE_SKILL,
+    BARTER_SKILL, NEGOTIATE_SKILL, ELITE, WEIGHT, ATTACK, ARMOR, IS_MELEE, IS_RANGED,
+    UNKNOWN
+};
+
+/* FNV-1a; usable at compile time so keys' hashes can be case labels*/
+static constexpr std::uint32_t keyHash(const char *key, std::uint32_t hash = 2166136261u)
 {
-    std::string::size_type split(0);
-    for(std::string::size_type i=0; i<line.size(); ++i) {
-	if(line[i] == '=') {
-	    split = i;
-	    break;
-	}
+    return *key == '\0' ? hash
+	: keyHash(key + 1, (hash ^ static_cast<unsigned char>(*key)) * 16777619u);
+}
+
+static std::uint32_t keyHash(StringRef key)
+{
+    std::uint32_t hash = 2166136261u;
+    for(char ch : key) {
+	hash = (hash ^ static_cast<unsigned char>(ch)) * 16777619u;
     }
-    return split;
+    return hash;
 }
 
-static char parseChar(std::string value, char defaultVal = 'A')
+//Case for one key in templateKey()'s switch. No two keys can share a hash
+//(duplicate case labels don't compile), making the switch a perfect hash;
+//other text still can, so it's checked against the key too
+#define TEMPLATE_KEY(text, value) \
+    case keyHash(text): return key == text ? TemplateKey::value : TemplateKey::UNKNOWN
+
+static TemplateKey templateKey(StringRef key)
 {
-    if(value.size() < 1 || value == "default") {
-	return defaultVal;
+    switch(keyHash(key)) {
+	TEMPLATE_KEY("char", CHAR);
+	TEMPLATE_KEY("name", NAME);
+	TEMPLATE_KEY("energy", ENERGY);
+	TEMPLATE_KEY("health", HEALTH);
+	TEMPLATE_KEY("carryWeight", CARRY_WEIGHT);
+	TEMPLATE_KEY("maxCarryWeight", MAX_CARRY_WEIGHT);
+	TEMPLATE_KEY("level", LEVEL);
+	TEMPLATE_KEY("levelProgress", LEVEL_PROGRESS);
+	TEMPLATE_KEY("strength", STRENGTH);
+	TEMPLATE_KEY("cunning", CUNNING);
+	TEMPLATE_KEY("agility", AGILITY);
+	TEMPLATE_KEY("education", EDUCATION);
+	TEMPLATE_KEY("sidearmSkill", SIDEARM_SKILL);
+	TEMPLATE_KEY("longarmSkill", LONGARM_SKILL);
+	TEMPLATE_KEY("meleeSkill", MELEE_SKILL);
+	TEMPLATE_KEY("barterSkill", BARTER_SKILL);
+	TEMPLATE_KEY("negotiateSkill", NEGOTIATE_SKILL);
+	TEMPLATE_KEY("elite", ELITE);
+	TEMPLATE_KEY("weight", WEIGHT);
+	TEMPLATE_KEY("attack", ATTACK);
+	TEMPLATE_KEY("armor", ARMOR);
+	TEMPLATE_KEY("isMelee", IS_MELEE);
+	TEMPLATE_KEY("isRanged", IS_RANGED);
+    default: return TemplateKey::UNKNOWN;
     }
-    return value[0];
 }
+#undef TEMPLATE_KEY
 
-static std::int_least16_t parseInt(std::string value, std::int_least16_t defaultVal = 0)
+//Value parsers return false (leaving result alone) if value is malformed;
+//"default" (or nothing) gives defaultVal
+static bool parseChar(StringRef value, char &result, char defaultVal = 'A')
 {
-    if(value.size() < 1 || value == "default") {
-	return defaultVal;
+    if(value.empty() || value == "default") {
+	result = defaultVal;
+	return true;
+    } else if(value.size() != 1) {
+	return false;
+    }
+    result = value[0];
+    return true;
+}
+
+static bool parseInt(StringRef value, std::int_least16_t &result,
+		     std::int_least16_t defaultVal = 0)
+{
+    if(value.empty() || value == "default") {
+	result = defaultVal;
+	return true;
+    }
+    bool negative = value[0] == '-';
+    if(negative || value[0] == '+') {
+	value = value.substr(1);
+    }
+    if(value.empty()) {
+	return false;
     }
-    try {
-	return std::stoi(value);
-    } catch(const std::out_of_range& e) {
-	return defaultVal;
+    long number = 0;
+    for(char ch : value) {
+	if(ch < '0' || ch > '9') {
+	    return false;
+	}
+	number = number * 10 + (ch - '0');
+	if(number > std::numeric_limits<std::int_least16_t>::max() + 1L) {
+	    return false;
+	}
     }
+    number = negative ? -number : number;
+    if(number > std::numeric_limits<std::int_least16_t>::max()) {
+	return false;
+    }
+    result = number;
+    return true;
 }
 
-static bool parseBool(std::string value, bool defaultVal = false)
+static bool parseBool(StringRef value, bool &result, bool defaultVal = false)
+{
+    if(value.empty() || value == "default") result = defaultVal;
+    else if(value == "true") result = true;
+    else if(value == "false") result = false;
+    else return false;
+    return true;
+}
+
+enum class PairResult { APPLIED, UNKNOWN_KEY, BAD_VALUE };
+
+static PairResult applied(bool parsed)
 {
-    if(value == "true") return true;
-    else if(value == "false") return false;
-    else return defaultVal;
+    return parsed ? PairResult::APPLIED : PairResult::BAD_VALUE;
 }
 
-static void applyIniPair(Actor &actor, std::string key, std::string value)
+/* Sets the field for key in actor*/
+static PairResult applyIniPair(Actor &actor, TemplateKey key, StringRef value)
 {
-    if(key == "char") actor.setCh(parseChar(value));
-    else if(key == "name") actor.setName(value);
-    else if(key == "energy") actor.setEnergy(parseInt(value));
-    else if(key == "health") actor.addHealth(parseInt(value, 100));
-    else if(key == "carryWeight") actor.m_carryWeight = parseInt(value);
-    else if(key == "carryWeight") actor.m_carryWeight = parseInt(value);
-    else if(key == "maxCarryWeight") actor.m_maxCarryWeight = parseInt(value, 10);
-    else if(key == "level") actor.m_level = parseInt(value);
-    else if(key == "levelProgress") actor.m_levelProgress = parseInt(value);
-    else if(key == "strength") actor.m_strength = parseInt(value);
-    else if(key == "cunning") actor.m_cunning = parseInt(value);
-    else if(key == "agility") actor.m_agility = parseInt(value);
-    else if(key == "education") actor.m_education = parseInt(value);
-    else if(key == "sidearmSkill") actor.m_sidearmSkill = parseInt(value);
-    else if(key == "longarmSkill") actor.m_longarmSkill = parseInt(value);
-    else if(key == "meleeSkill") actor.m_meleeSkill = parseInt(value);
-    else if(key == "barterSkill") actor.m_barterSkill = parseInt(value);
-    else if(key == "negotiateSkill") actor.m_negotiateSkill = parseInt(value);
+    std::int_least16_t number = 0;
+    bool flag = false;
+    char ch = 0;
+    switch(key) {
+    case TemplateKey::CHAR:
+	if(!parseChar(value, ch)) return PairResult::BAD_VALUE;
+	actor.setCh(ch);
+	return PairResult::APPLIED;
+    case TemplateKey::NAME:
+	actor.setName(value.str());
+	return PairResult::APPLIED;
+    case TemplateKey::ENERGY:
+	if(!parseInt(value, number)) return PairResult::BAD_VALUE;
+	actor.setEnergy(number);
+	return PairResult::APPLIED;
+    case TemplateKey::HEALTH:
+	if(!parseInt(value, number, 100)) return PairResult::BAD_VALUE;
+	actor.addHealth(number);
+	return PairResult::APPLIED;
+    case TemplateKey::CARRY_WEIGHT: return applied(parseInt(value, actor.m_carryWeight));
+    case TemplateKey::MAX_CARRY_WEIGHT: return applied(parseInt(value, actor.m_maxCarryWeight, 10));
+    case TemplateKey::LEVEL: return applied(parseInt(value, actor.m_level));
+    case TemplateKey::LEVEL_PROGRESS: return applied(parseInt(value, actor.m_levelProgress));
+    case TemplateKey::STRENGTH: return applied(parseInt(value, actor.m_strength));
+    case TemplateKey::CUNNING: return applied(parseInt(value, actor.m_cunning));
+    case TemplateKey::AGILITY: return applied(parseInt(value, actor.m_agility));
+    case TemplateKey::EDUCATION: return applied(parseInt(value, actor.m_education));
+    case TemplateKey::SIDEARM_SKILL: return applied(parseInt(value, actor.m_sidearmSkill));
+    case TemplateKey::LONGARM_SKILL: return applied(parseInt(value, actor.m_longarmSkill));
+    case TemplateKey::MELEE_SKILL: return applied(parseInt(value, actor.m_meleeSkill));
+    case TemplateKey::BARTER_SKILL: return applied(parseInt(value, actor.m_barterSkill));
+    case TemplateKey::NEGOTIATE_SKILL: return applied(parseInt(value, actor.m_negotiateSkill));
+    case TemplateKey::ELITE:
+	if(!parseBool(value, flag)) return PairResult::BAD_VALUE;
+	actor.setElite(flag);
+	return PairResult::APPLIED;
+    default:
+	return PairResult::UNKNOWN_KEY;
+    }
+}
+
+/* Sets the field for key in item. An item's char is kept by the loader
+   instead, since it isn't part of the Item*/
+static PairResult applyIniPair(Item &item, TemplateKey key, StringRef value)
+{
+    std::int_least16_t number = 0;
+    bool flag = false;
+    switch(key) {
+    case TemplateKey::CHAR:
+	return PairResult::APPLIED;
+    case TemplateKey::NAME:
+	item.setName(value.str());
+	return PairResult::APPLIED;
+    case TemplateKey::WEIGHT:
+	if(!parseInt(value, number)) return PairResult::BAD_VALUE;
+	item.setWeight(number);
+	return PairResult::APPLIED;
+    case TemplateKey::ATTACK:
+	if(!parseInt(value, number)) return PairResult::BAD_VALUE;
+	item.setAttack(number);
+	return PairResult::APPLIED;
+    case TemplateKey::ARMOR:
+	if(!parseInt(value, number)) return PairResult::BAD_VALUE;
+	item.setArmor(number);
+	return PairResult::APPLIED;
+    case TemplateKey::IS_MELEE:
+	if(!parseBool(value, flag)) return PairResult::BAD_VALUE;
+	item.setMelee(flag);
+	return PairResult::APPLIED;
+    case TemplateKey::IS_RANGED:
+	if(!parseBool(value, flag)) return PairResult::BAD_VALUE;
+	item.setRanged(flag);
+	return PairResult::APPLIED;
+    default:
+	return PairResult::UNKNOWN_KEY;
+    }
 }
 
-static void applyIniPair(Item &item, std::string key, std::string value)
+static void addError(std::vector<TemplateError> *errors, int line, const std::string &message)
 {
-    if(key == "name") item.setName(value);
-    else if(key == "weight") item.setWeight(parseInt(value));
-    else if(key == "attack") item.setAttack(parseInt(value));
-    else if(key == "armor") item.setArmor(parseInt(value));
-    else if(key == "isMelee") item.setMelee(parseBool(value));
-    else if(key == "isRanged") item.setRanged(parseBool(value));
+    if(errors) {
+	errors->push_back(TemplateError{line, message});
+    }
 }
 
-std::map<char,Item> loadItemTemplates(const std::string &&path)
+/* Parses a template file in one pass over its (mapped) contents: sections of
+   key=value lines separated by blank lines, with #comments. Each finished
+   section that has a char is added to templates, keyed by that char;
+   malformed lines are skipped and reported in errors*/
+template<typename T>
+static std::map<char,T> parseTemplates(const std::string &path, char defaultCh,
+				       std::vector<TemplateError> *errors)
 {
-    std::ifstream itemFile(path);
+    std::map<char,T> templates;
+    MappedFile file(path);
+    if(!file.isOpen()) {
+	addError(errors, 0, "could not open " + path);
+	return templates;
+    }
 
+    const StringRef contents = file.contents();
+    const char *pos = contents.begin();
+    T newTemplate;
     char ch = 0;
     bool hasCh = false;
-    std::map<char,Item> templates;
-    Item newTemplate;
-    while(itemFile) {
-	std::string line;
-	std::getline(itemFile, line);
+    bool inSection = false;
+    int lineNumber = 0;
+    while(pos != contents.end()) {
+	const char *end = static_cast<const char*>(std::memchr(pos, '\n', contents.end() - pos));
+	if(!end) {
+	    end = contents.end();
+	}
+	StringRef line(pos, end - pos);
+	pos = end == contents.end() ? end : end + 1;
+	++lineNumber;
+	if(!line.empty() && line[line.size()-1] == '\r') {
+	    line = line.substr(0, line.size() - 1);
+	}
+
 	//Skip comments
-	if(line[0] == '#')
+	if(!line.empty() && line[0] == '#') {
 	    continue;
+	}
 	//Finalize/add template when at blank line (end of section)
-	else if(line == "" && hasCh) {
-	    templates[ch] = newTemplate;
-	    newTemplate = Item();
+	if(line.empty()) {
+	    if(inSection) {
+		if(hasCh) templates[ch] = newTemplate;
+		else addError(errors, lineNumber - 1, "section has no char");
+	    }
+	    newTemplate = T();
 	    hasCh = false;
+	    inSection = false;
 	    continue;
 	}
-	//Find out where '=' is; it's the division between key/value
-	auto split = findSplit(line);
-	//Ignore erroneously formatted lines
-	if(split == 0 || split == (line.size() - 1)) {
+	inSection = true;
+
+	//'=' is the division between key/value
+	const char *split = static_cast<const char*>(std::memchr(line.data(), '=', line.size()));
+	if(!split || split == line.begin()) {
+	    addError(errors, lineNumber, "expected key=value: " + line.str());
 	    continue;
 	}
-
-	if(line.substr(0, split) == "char") {
-	    //All items represented by a char in map files, but not onscreen,
-	    //so char not part of the Item objects themselves
-	    ch = parseChar(line.substr(split+1), '-');
+	StringRef key(line.begin(), split - line.begin());
+	StringRef value(split + 1, line.end() - split - 1);
+	TemplateKey field = templateKey(key);
+	if(field == TemplateKey::CHAR) {
+	    //Every template is represented by a char in map files
+	    if(!parseChar(value, ch, defaultCh)) {
+		addError(errors, lineNumber, "expected a single char: " + value.str());
+		continue;
+	    }
 	    hasCh = true;
 	}
-
-	applyIniPair(newTemplate, line.substr(0, split), line.substr(split+1));
+	switch(applyIniPair(newTemplate, field, value)) {
+	case PairResult::UNKNOWN_KEY:
+	    addError(errors, lineNumber, "unknown key: " + key.str());
+	    break;
+	case PairResult::BAD_VALUE:
+	    addError(errors, lineNumber, "bad value for " + key.str() + ": " + value.str());
+	    break;
+	case PairResult::APPLIED:
+	    break;
+	}
+    }
+    //Last section may not have a blank line after it
+    if(inSection) {
+	if(hasCh) templates[ch] = newTemplate;
+	else addError(errors, lineNumber, "section has no char");
     }
     return templates;
 }
 
-std::map<char,Actor> loadMonsterTemplates(const std::string &&path)
+std::map<char,Item> loadItemTemplates(const std::string &&path,
+				      std::vector<TemplateError> *errors)
 {
-    std::ifstream monsterFile(path);
-
-    std::map<char,Actor> templates;
-    Actor newTemplate;
-    while(monsterFile) {
-	std::string line;
-	std::getline(monsterFile, line);
-	//Skip comments
-	if(line[0] == '#')
-	    continue;
-	//Finalize/add template when at blank line (end of section)
-	else if(line == "") {
-	    templates[newTemplate.getCh()] = newTemplate;
-	    newTemplate = Actor();
-	    continue;
-	}
-	//Find out where '=' is; it's the division between key/value
-	auto split = findSplit(line);
-	//Ignore erroneously formatted lines
-	if(split == 0 || split == (line.size() - 1)) {
-	    continue;
-	}
+    TRACE_SCOPE("loadItemTemplates");
+    return parseTemplates<Item>(path, '-', errors);
+}
 
-	applyIniPair(newTemplate, line.substr(0, split), line.substr(split+1));
-    }
-    return templates;
+std::map<char,Actor> loadMonsterTemplates(const std::string &&path,
+					  std::vector<TemplateError> *errors)
+{
+    TRACE_SCOPE("loadMonsterTemplates");
+    return parseTemplates<Actor>(path, 'A', errors);
 }
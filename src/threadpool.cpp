@@ -0,0 +1,118 @@
+#include "include/threadpool.h"
+
+//Which pool/queue the current thread works for, if any; lets tasks that
+//submit more tasks put them on their own worker's queue
+static thread_local ThreadPool *t_pool = nullptr;
+static thread_local int t_worker = -1;
+
+/* Starts the given number of worker threads, which sleep until tasks arrive*/
+ThreadPool::ThreadPool(int threadCount)
+    : m_queued(0), m_pending(0), m_stopping(false), m_nextQueue(0)
+{
+    if(threadCount < 1) {
+	threadCount = 1;
+    }
+    for(int i=0; i<threadCount; ++i) {
+	m_queues.emplace_back(new WorkQueue());
+    }
+    m_workers.reserve(threadCount);
+    for(int i=0; i<threadCount; ++i) {
+	m_workers.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+/* Finishes any queued tasks, then joins all workers*/
+ThreadPool::~ThreadPool()
+{
+    {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stopping = true;
+    }
+    m_hasTask.notify_all();
+    for(std::thread &worker : m_workers) {
+	worker.join();
+    }
+}
+
+/* One worker per hardware thread; hardware_concurrency() may return 0
+   if it can't tell*/
+int ThreadPool::defaultThreadCount()
+{
+    unsigned int count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+/* Takes the newest task from the worker's own queue, or else steals the
+   oldest task from another worker's queue*/
+bool ThreadPool::takeTask(int worker, std::function<void()> &task)
+{
+    {
+	WorkQueue &own = *m_queues[worker];
+	std::lock_guard<std::mutex> lock(own.mutex);
+	if(!own.tasks.empty()) {
+	    task = std::move(own.tasks.back());
+	    own.tasks.pop_back();
+	    --m_queued;
+	    return true;
+	}
+    }
+    for(std::size_t i=1; i<m_queues.size(); ++i) {
+	WorkQueue &other = *m_queues[(worker + i) % m_queues.size()];
+	std::lock_guard<std::mutex> lock(other.mutex);
+	if(!other.tasks.empty()) {
+	    task = std::move(other.tasks.front());
+	    other.tasks.pop_front();
+	    --m_queued;
+	    return true;
+	}
+    }
+    return false;
+}
+
+/* Worker loop: run tasks until the pool is destroyed*/
+void ThreadPool::work(int worker)
+{
+    t_pool = this;
+    t_worker = worker;
+    while(true) {
+	std::function<void()> task;
+	if(!takeTask(worker, task)) {
+	    std::unique_lock<std::mutex> lock(m_mutex);
+	    m_hasTask.wait(lock, [this] { return m_stopping || m_queued > 0; });
+	    if(m_stopping && m_queued == 0) {
+		return;
+	    }
+	    continue;
+	}
+	task();
+	{
+	    std::lock_guard<std::mutex> lock(m_mutex);
+	    --m_pending;
+	}
+	m_allDone.notify_all();
+    }
+}
+
+/* Queues a task; tasks submitted by a worker go on its own queue, others
+   are spread over all the queues*/
+void ThreadPool::submit(std::function<void()> task)
+{
+    int queue = t_pool == this ? t_worker : m_nextQueue++ % m_queues.size();
+    {
+	std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+	m_queues[queue]->tasks.push_back(std::move(task));
+    }
+    {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	++m_queued;
+	++m_pending;
+    }
+    m_hasTask.notify_one();
+}
+
+/* Blocks until every task submitted so far has finished*/
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_allDone.wait(lock, [this] { return m_pending == 0; });
+}
@@ -0,0 +1,46 @@
+#include "include/tiles.h"
+
+/* Creates a table with only the built-in tiles; any other char is an
+   obstacle until build() gives it a template*/
+TileTable::TileTable()
+{
+    build(std::map<char,Actor>(), std::map<char,Item>());
+}
+
+/* Fills the table from the given templates, replacing any previous ones.
+   Templates can't redefine the empty, wall, or player tiles*/
+void TileTable::build(const std::map<char,Actor> &monsters, const std::map<char,Item> &items)
+{
+    for(int ch=0; ch<256; ++ch) {
+	m_info[ch] = TileInfo{TileKind::WALL, static_cast<char>(ch), -1};
+    }
+    m_monsters.clear();
+    m_items.clear();
+    //Item chars without a template still can't be walked through
+    m_info[static_cast<unsigned char>(ItemTile)].kind = TileKind::ITEM;
+    for(const auto &entry : items) {
+	TileInfo &info = m_info[static_cast<unsigned char>(entry.first)];
+	info = TileInfo{TileKind::ITEM, entry.first, static_cast<std::int16_t>(m_items.size())};
+	m_items.push_back(entry.second);
+    }
+    for(const auto &entry : monsters) {
+	TileInfo &info = m_info[static_cast<unsigned char>(entry.first)];
+	info = TileInfo{TileKind::MONSTER, entry.first, static_cast<std::int16_t>(m_monsters.size())};
+	m_monsters.push_back(entry.second);
+    }
+    m_info[0] = TileInfo{TileKind::EMPTY, EmptySpace, -1};
+    m_info[static_cast<unsigned char>(WallTile)] = TileInfo{TileKind::WALL, WallTile, -1};
+    m_info[static_cast<unsigned char>(PlayerTile)] = TileInfo{TileKind::PLAYER, PlayerTile, -1};
+}
+
+const Actor* TileTable::monster(char ch) const
+{
+    const TileInfo &info = (*this)[ch];
+    return info.kind == TileKind::MONSTER ? &m_monsters[info.templateId] : nullptr;
+}
+
+const Item* TileTable::item(char ch) const
+{
+    const TileInfo &info = (*this)[ch];
+    return info.kind == TileKind::ITEM && info.templateId >= 0 ? &m_items[info.templateId] : nullptr;
+}
@@ -0,0 +1,107 @@
+#include "include/trace.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+struct TraceEvent {
+    const char *name;
+    std::int64_t start, duration; //In nanoseconds since tracing started
+};
+
+struct ThreadBuffer {
+    int threadId;
+    std::vector<TraceEvent> events;
+};
+
+typedef std::chrono::steady_clock TraceClock;
+static const TraceClock::time_point traceStart = TraceClock::now();
+
+//Every thread's buffer; outlives the threads so their events can be written
+//after they exit. Only locked when a thread records its first event
+static std::mutex buffersMutex;
+static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+static std::int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+	TraceClock::now() - traceStart).count();
+}
+
+static ThreadBuffer& threadBuffer()
+{
+    static thread_local ThreadBuffer *buffer = nullptr;
+    if(!buffer) {
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	buffers.emplace_back(new ThreadBuffer{static_cast<int>(buffers.size()), {}});
+	buffer = buffers.back().get();
+    }
+    return *buffer;
+}
+
+TraceScope::TraceScope(const char *name)
+    : m_name(name), m_start(now())
+{
+}
+
+TraceScope::~TraceScope()
+{
+    std::int64_t end = now();
+    ThreadBuffer &buffer = threadBuffer();
+    if(buffer.events.size() < MaxTraceEventsPerThread) {
+	buffer.events.push_back(TraceEvent{m_name, m_start, end - m_start});
+    }
+}
+
+/* The functions below read every thread's buffer, so only call them while no
+   other thread is recording (e.g. once worker pools have finished)*/
+std::size_t traceEventCount()
+{
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    std::size_t count = 0;
+    for(const auto &buffer : buffers) {
+	count += buffer->events.size();
+    }
+    return count;
+}
+
+void clearTrace()
+{
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for(auto &buffer : buffers) {
+	buffer->events.clear();
+    }
+}
+
+/* Writes all recorded events in Chrome's trace event format (complete "X"
+   events, times in microseconds), one track per thread*/
+void writeChromeTrace(std::ostream &out)
+{
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for(const auto &buffer : buffers) {
+	for(const TraceEvent &event : buffer->events) {
+	    out << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name
+		<< "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+		<< ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << event.duration / 1000.0
+		<< "}";
+	    first = false;
+	}
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+bool writeChromeTrace(const std::string &path)
+{
+    std::ofstream out(path);
+    if(!out) {
+	return false;
+    }
+    writeChromeTrace(out);
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,131 @@
+#include "include/watcher.h"
+#include "include/mappedfile.h"
+#include "include/trace.h"
+#include <chrono>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+/* Starts watching the given template files; reparsed templates become
+   available from take()*/
+TemplateWatcher::TemplateWatcher(const std::string &monstersFile, const std::string &itemsFile)
+    : m_monstersFile(monstersFile), m_itemsFile(itemsFile), m_stopping(false),
+      m_inotifyFd(startInotify()), m_monstersStamp(fileStamp(monstersFile)),
+      m_itemsStamp(fileStamp(itemsFile))
+{
+    if(m_inotifyFd >= 0) {
+	m_thread = std::thread(&TemplateWatcher::watchWithInotify, this);
+    } else {
+	m_thread = std::thread(&TemplateWatcher::watchWithPolling, this);
+    }
+}
+
+TemplateWatcher::~TemplateWatcher()
+{
+    m_stopping = true;
+    m_thread.join();
+#ifdef __linux__
+    if(m_inotifyFd >= 0) {
+	close(m_inotifyFd);
+    }
+#endif
+}
+
+/* Hands over the templates parsed since the last call, if any*/
+std::unique_ptr<TemplateSet> TemplateWatcher::take()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::move(m_ready);
+}
+
+/* Parses the files (on the watcher thread), replacing any result not yet taken*/
+void TemplateWatcher::reload()
+{
+    TRACE_SCOPE("TemplateWatcher::reload");
+    std::unique_ptr<TemplateSet> templates(
+	new TemplateSet(loadTemplateSetFromIni(m_monstersFile, m_itemsFile)));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ready = std::move(templates);
+}
+
+#ifdef __linux__
+static std::string directoryOf(const std::string &path)
+{
+    std::string::size_type slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+static std::string fileNameOf(const std::string &path)
+{
+    return path.substr(path.find_last_of("/\\") + 1);
+}
+#endif
+
+/* Watches the files' directories rather than the files themselves, so
+   editors that save by replacing the file are seen too; returns -1 if
+   inotify isn't available*/
+int TemplateWatcher::startInotify() const
+{
+#ifdef __linux__
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(fd < 0) {
+	return -1;
+    }
+    const std::uint32_t events = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+    if(inotify_add_watch(fd, directoryOf(m_monstersFile).c_str(), events) < 0
+       || inotify_add_watch(fd, directoryOf(m_itemsFile).c_str(), events) < 0) {
+	close(fd);
+	return -1;
+    }
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+/* Waits on inotify events for either file until stopped, reparsing once
+   a burst of changes has settled*/
+void TemplateWatcher::watchWithInotify()
+{
+#ifdef __linux__
+    const std::string monstersName = fileNameOf(m_monstersFile);
+    const std::string itemsName = fileNameOf(m_itemsFile);
+    alignas(inotify_event) char buffer[4096];
+    bool changed = false;
+    while(!m_stopping) {
+	pollfd ready{m_inotifyFd, POLLIN, 0};
+	if(poll(&ready, 1, changed ? WatchSettleMs : WatchPollMs) <= 0) {
+	    if(changed) {
+		reload();
+		changed = false;
+	    }
+	    continue;
+	}
+	ssize_t size = read(m_inotifyFd, buffer, sizeof(buffer));
+	for(ssize_t pos = 0; pos < size; ) {
+	    const inotify_event *event = reinterpret_cast<const inotify_event*>(buffer + pos);
+	    if(event->len > 0 && (monstersName == event->name || itemsName == event->name)) {
+		changed = true;
+	    }
+	    pos += sizeof(inotify_event) + event->len;
+	}
+    }
+#endif
+}
+
+/* Checks the files' stamps every WatchPollMs until stopped*/
+void TemplateWatcher::watchWithPolling()
+{
+    while(!m_stopping) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(WatchPollMs));
+	std::uint64_t monstersStamp = fileStamp(m_monstersFile);
+	std::uint64_t itemsStamp = fileStamp(m_itemsFile);
+	if(monstersStamp != m_monstersStamp || itemsStamp != m_itemsStamp) {
+	    m_monstersStamp = monstersStamp;
+	    m_itemsStamp = itemsStamp;
+	    reload();
+	}
+    }
+}
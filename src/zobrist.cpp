@@ -0,0 +1,74 @@
+#include "include/zobrist.h"
+
+//Distinguishes the kinds of keys so that, e.g., a tile and an Item
+//at the same position never share a key
+enum KeyKind : std::uint64_t {
+    KEY_TILE = 1,
+    KEY_ACTOR,
+    KEY_ITEM
+};
+
+/* SplitMix64 finalizer; spreads the bits of value over the whole word*/
+static std::uint64_t mix(std::uint64_t value)
+{
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+/* Folds another field into a running key*/
+static std::uint64_t combine(std::uint64_t key, std::uint64_t field)
+{
+    return mix(key ^ field);
+}
+
+/* FNV-1a hash of a string; unlike std::hash, stable across builds*/
+static std::uint64_t hashString(const std::string &text)
+{
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for(char letter : text) {
+	hash ^= static_cast<unsigned char>(letter);
+	hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static std::uint64_t positionKey(KeyKind kind, int x, int y)
+{
+    return combine(combine(mix(kind), static_cast<std::uint32_t>(x)),
+		   static_cast<std::uint32_t>(y));
+}
+
+/* Key for a single map cell holding the given character*/
+std::uint64_t tileKey(int x, int y, char ch)
+{
+    return combine(positionKey(KEY_TILE, x, y), static_cast<unsigned char>(ch));
+}
+
+/* Key for everything about an Actor that can change during play: position,
+   health, energy, progress, carried weight, and equipped items*/
+std::uint64_t actorKey(const Actor &actor)
+{
+    std::uint64_t key = positionKey(KEY_ACTOR, actor.getX(), actor.getY());
+    key = combine(key, static_cast<std::uint32_t>(actor.getHealth()));
+    key = combine(key, static_cast<std::uint32_t>(actor.getEnergy()));
+    key = combine(key, static_cast<std::uint16_t>(actor.m_levelProgress));
+    key = combine(key, static_cast<std::uint16_t>(actor.m_carryWeight));
+    key = combine(key, static_cast<std::uint32_t>(actor.getInventorySize()));
+    for(int i=0; i<EQUIP_MAX; ++i) {
+	const Item *item = actor.getEquipped(i);
+	if(item != nullptr) {
+	    key = combine(key, combine(static_cast<std::uint64_t>(i),
+				       hashString(item->getName())));
+	}
+    }
+    return key;
+}
+
+/* Key for an Item lying on the map*/
+std::uint64_t itemKey(const Item &item)
+{
+    return combine(positionKey(KEY_ITEM, item.getX(), item.getY()),
+		   hashString(item.getName()));
+}
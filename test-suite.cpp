@@ -1,10 +1,29 @@
 #include "src/include/actor.h"
+#include "src/include/zobrist.h"
+#include "src/include/history.h"
+#include "src/include/lookahead.h"
+#include "src/include/agent.h"
+#include "src/include/batch.h"
+#include "src/include/scenario.h"
+#include "src/include/horde.h"
+#include "src/include/trace.h"
+#include "src/include/gameboard.h"
+#include "src/include/bundle.h"
+#include "src/include/rays.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
 #include <iostream>
 #include <cassert>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <sys/stat.h>
 
-bool actorWins(int skillAmt, int otherSkillAmt);
-int getArmorBonus(int skillAmt, Item *armor);
-bool actorWinsFight(int skillAmt, int otherSkillAmt, Item *armor, Item *otherArmor);
+bool actorWins(int skillAmt, int otherSkillAmt, std::mt19937 &generator);
+int getArmorBonus(int skillAmt, const Item *armor);
+bool actorWinsFight(int skillAmt, int otherSkillAmt, const Item *armor, const Item *otherArmor,
+		    std::mt19937 &generator);
 
 std::string getLocalDir() { return "./"; }
 
@@ -15,10 +34,11 @@ static double checkWins(int playerSkill, int enemySkill )
 {
   int playerWins = 0;
   int enemyWins = 0;
+  std::mt19937 generator(playerSkill * 100 + enemySkill);
   for(int i=0; i<1000000; ++i)
   {
     //Difference of 5pts -> 75% more wins; 0pts -> 2% more, 20pts -> all wins
-    if(actorWins(playerSkill, enemySkill)) {
+    if(actorWins(playerSkill, enemySkill, generator)) {
       playerWins += 1;
     }
     else {
@@ -79,7 +99,7 @@ static void testItems()
   //Getter/constructor
   {
     Item a;
-    assert(a.getId() == 0 && "Item id doesn't start at 0");
+    assert(a.getId() == -1 && "Item numbered before it's on a board");
     assert(a.getX() == 0 && a.getY() == 0 && "Item position doesn't start at (0,0)");
     assert(a.getWeight() == 0 && "Item weight doesn't start at 0");
     assert(a.getArmor() == 0 && "Item armor doesn't start at 0");
@@ -90,7 +110,7 @@ static void testItems()
   //Setters/creating multiple objects
   {
     Item b(1, 0, "Knife", 4, 1);
-    assert(b.getId() == 1 && "Item id doesn't increment by 1");
+    assert(b.getId() == -1 && "Item numbered before it's on a board");
     assert(b.getX() == 1 && b.getY() == 0 && "Item Position not set");
     assert(b.getWeight() == 4 && "Item weight doesn't start at 0");
     assert(b.getArmor() == 1 && "Item armor not set");
@@ -100,6 +120,13 @@ static void testItems()
     b.setRanged(true);
     assert(b.isRanged() && "Item not able to be made ranged");
   }
+  //Each board numbers its own Items, whatever was played before it
+  {
+    GameBoard first(nullptr, Actor(0, 0, "Player", PlayerTile, true), "test-map1.csv", 1);
+    GameBoard second(nullptr, Actor(0, 0, "Player", PlayerTile, true), "test-map1.csv", 1);
+    assert(first.player().getItemAt(0)->getId() == 0 && second.player().getItemAt(0)->getId() == 0
+	   && "Item ids shared between boards");
+  }
   std::cout << "All item tests passed\n";
 }
 
@@ -143,11 +170,13 @@ static void testActors()
     auto prevHealthA = a.getHealth();
     auto prevHealthB = b.getHealth();
     assert(prevHealthA == prevHealthB && "Actors not starting out with same health");
-    a.attack(b);
+    std::mt19937 generator(1);
+    a.attack(b, generator);
     assert((b.getHealth() < prevHealthB || a.getHealth() < prevHealthA)
 	   && "Attacks not causing damage");
 
     Item i(0, 0, "Knife", 5, 2);
+    i.setId(7);
     Actor c;
     assert(c.canCarry(i.getWeight()) && "Item weight not matching with carry capacity");
     c.addItem(i);
@@ -165,10 +194,1219 @@ static void testActors()
   std::cout << "All actor tests passed\n";
 }
 
+static void testHashing()
+{
+  //Keys depend only on state, so equal state hashes equally
+  {
+    Actor a(3, 4, "Joe", 'J');
+    Actor b(3, 4, "Joe", 'J');
+    assert(actorKey(a) == actorKey(b) && "Equal Actors hashing differently");
+    b.move(3, 5);
+    assert(actorKey(a) != actorKey(b) && "Actor position not part of key");
+    b.move(3, 4);
+    b.setEnergy(a.getEnergy());
+    b.addHealth(-1);
+    assert(actorKey(a) != actorKey(b) && "Actor health not part of key");
+  }
+  //Tile keys differ by position and by character
+  {
+    assert(tileKey(1, 2, '#') != tileKey(2, 1, '#') && "Tile position not part of key");
+    assert(tileKey(1, 2, '#') != tileKey(1, 2, 0) && "Tile char not part of key");
+    //Incremental update: XOR out old tile, XOR in new tile
+    std::uint64_t hash = tileKey(0, 0, 0) ^ tileKey(1, 0, 'B');
+    hash ^= tileKey(1, 0, 'B') ^ tileKey(1, 0, 0);
+    hash ^= tileKey(0, 0, 0) ^ tileKey(0, 0, 'B');
+    assert(hash == (tileKey(0, 0, 'B') ^ tileKey(1, 0, 0))
+	   && "Incremental hash doesn't match full hash");
+  }
+  std::cout << "All hashing tests passed\n";
+}
+
+static void testHistory()
+{
+  LayeredMap map{};
+  LevelMap &actorLayer = map.layer(MapLayer::ACTORS);
+  ActorList actors{Actor(1, 1, "Joe", 'J'), Actor(2, 2, "Bob", 'B')};
+  ItemList items{Item(3, 3, "Knife", 4)};
+  actorLayer[1][1] = 'J';
+  actorLayer[2][2] = 'B';
+  map.layer(MapLayer::ITEMS)[3][3] = ItemTile;
+  std::vector<Perception> perception{Perception{false, 0, 0, -1, 1}, Perception{true, 1, 1, 0, 0}};
+  History history;
+  history.beginTurn(42, 0, 0);
+  //Joe moves, kills Bob, and picks up the knife
+  history.recordActor(0, actors[0]);
+  actors[0].move(1, 2);
+  history.recordTile(MapLayer::ACTORS, 1, 1, actorLayer[1][1]);
+  actorLayer[1][1] = 0;
+  history.recordTile(MapLayer::ACTORS, 1, 2, actorLayer[2][1]);
+  actorLayer[2][1] = 'J';
+  history.recordPerception(0, perception[0]);
+  perception[0].target = -1;
+  history.recordActorErased(1, actors[1]);
+  actors.erase(actors.begin()+1);
+  history.recordPerceptionErased(1, perception[1]);
+  perception.erase(perception.begin()+1);
+  history.recordActorSnapshot(0, actors[0]);
+  actors[0].addItem(items[0]);
+  history.recordItemErased(0, items[0]);
+  items.erase(items.begin());
+  history.recordTile(MapLayer::ITEMS, 3, 3, ItemTile);
+  map.layer(MapLayer::ITEMS)[3][3] = 0;
+  assert(history.size() == 1 && "Turn not recorded");
+
+  TurnRecord turn = history.undoTurn(map, actors, items, perception);
+  assert(turn.hash == 42 && history.size() == 0 && "Turn record not returned");
+  assert(actors.size() == 2 && actors[1].getName() == "Bob" && "Erased Actor not restored");
+  assert(actors[0].getX() == 1 && actors[0].getY() == 1 && "Actor position not restored");
+  assert(actors[0].getInventorySize() == 0 && "Actor inventory not restored");
+  assert(items.size() == 1 && items[0].getName() == "Knife" && "Erased Item not restored");
+  assert(map.actors()[1][1] == 'J' && map.actors()[2][1] == 0 && map.items()[3][3] == ItemTile
+	 && "Tiles not restored");
+  assert(perception.size() == 2 && perception[0].target == 1 && perception[1].seesPlayer
+	 && perception[1].target == 0 && "Perception not restored");
+  //So does the state the turn started from
+  std::mt19937 generator(9);
+  generator.discard(5);
+  const std::mt19937 started = generator;
+  TurnStart start;
+  start.generator = generator;
+  history.beginTurn(43, 0, 0, start);
+  generator();
+  assert(history.undoTurn(map, actors, items, perception).start.generator == started
+	 && "Turn start not restored");
+
+  //Oldest turns are dropped once the history is full
+  for(int i=0; i<MaxHistoryTurns+5; ++i) {
+    history.beginTurn(i, 0, 0);
+  }
+  assert(history.size() == MaxHistoryTurns && "History not capped");
+  std::cout << "All history tests passed\n";
+}
+
+static void testLookahead()
+{
+  SearchState state;
+  state.blocked.assign(MapWidth * MapHeight, false);
+  state.monster = Combatant{5, 5, 10, TurnEnergy, CombatStats{12, 0, -1}};
+  state.player = Combatant{7, 5, 3, TurnEnergy, CombatStats{0, 0, -1}};
+  ThreadPool pool(2);
+  std::mt19937 seeder(3);
+  //Search picks some legal step
+  {
+    int dx = 9, dy = 9;
+    assert(chooseLookaheadMove(state, &pool, seeder, dx, dy) && "No move found in open space");
+    assert(dx >= -1 && dx <= 1 && dy >= -1 && dy <= 1 && !(dx == 0 && dy == 0)
+	   && "Lookahead move isn't a single step");
+    dx = 9;
+    assert(chooseLookaheadMove(state, nullptr, seeder, dx, dy) && dx != 9
+	   && "No move found searching on calling thread");
+  }
+  //A counted search picks the same move from the same seed, however many workers
+  {
+    std::mt19937 serialSeeder(5), parallelSeeder(5);
+    for(int i=0; i<5; ++i) {
+      int serialX = 9, serialY = 9, parallelX = 9, parallelY = 9;
+      assert(chooseLookaheadMove(state, nullptr, serialSeeder, serialX, serialY, LookaheadRollouts)
+	     && chooseLookaheadMove(state, &pool, parallelSeeder, parallelX, parallelY, LookaheadRollouts)
+	     && serialX == parallelX && serialY == parallelY && "Counted search not reproducible");
+    }
+  }
+  //Boxed-in monster has no move
+  {
+    for(int dy=-1; dy<=1; ++dy) {
+      for(int dx=-1; dx<=1; ++dx) {
+	state.blocked[(5 + dy) * MapWidth + 5 + dx] = true;
+      }
+    }
+    int dx = 0, dy = 0;
+    assert(!chooseLookaheadMove(state, &pool, seeder, dx, dy) && "Boxed-in monster found a move");
+  }
+  //Same generator seed, same fight
+  {
+    std::mt19937 a(7), b(7);
+    int damageA = 0, damageB = 0;
+    bool winA = resolveAttack(state.monster.stats, state.player.stats, damageA, a);
+    bool winB = resolveAttack(state.monster.stats, state.player.stats, damageB, b);
+    assert(winA == winB && damageA == damageB && "Seeded fights not reproducible");
+  }
+  //The game's own map has an elite to meet
+  GameBoard game(nullptr, Actor(0, 0, "Player", PlayerTile, true), "trapped-map.csv", 1);
+  bool hasElite = false;
+  for(const Actor &actor : game.actors()) {
+    hasElite = hasElite || actor.isElite();
+  }
+  assert(hasElite && "No elite on the game's map");
+  //Elites awake together share one search budget per monsters' turn
+  LevelMap arena(30, 15);
+  arena[7][15] = PlayerTile;
+  for(int x=9; x<=21; x+=3) {
+    arena[3][x] = 'P';
+    arena[11][x] = 'P';
+  }
+  Actor tough(0, 0, "Player", PlayerTile, true);
+  tough.addHealth(20000);
+  GameBoard elites(nullptr, tough, arena, 2);
+  elites.endTurn(elites.player());
+  SearchClock::time_point start = SearchClock::now();
+  do {
+    elites.updateActors();
+  } while(!elites.player().isTurn());
+  assert(SearchClock::now() - start < std::chrono::milliseconds(5 * LookaheadBudgetMs)
+	 && "Elites searched longer than a turn's budget");
+  std::cout << "All lookahead tests passed\n";
+}
+
+/* Plays a headless game through the agent interface, checking the
+ * incrementally-kept hash and turn rewinding along the way */
+static void testAgent()
+{
+  GameBoard board(nullptr, Actor(0, 0, "Player", PlayerTile, true), "test-map1.csv", 1);
+  Agent agent(board);
+  Observation start = agent.observe();
+  assert(start.alive && start.turn == 0 && start.hash == board.computeHash()
+	 && "Bad first observation");
+  assert(!start.tiles.empty() && !start.actors.empty() && start.inventory.size() == 1
+	 && "Observation missing tiles/actors/inventory");
+
+  Action action;
+  assert(parseAction("move 1 0", action) && action.type == ActionType::MOVE
+	 && action.a == 1 && action.b == 0 && "Move action not parsed");
+  assert(!parseAction("fly 1 0", action) && "Unknown action parsed");
+  int width = board.map().width();
+  assert(!agent.act(Action{ActionType::RANGE_ATTACK, 1000000000, 0})
+	 && !agent.act(Action{ActionType::RANGE_ATTACK, width + 5, 3})
+	 && !agent.act(Action{ActionType::TELEPORT, -1, 0}) && board.turn() == 0
+	 && "Off-map target accepted");
+
+  //Only what the player can see is reported: not the cells or monsters
+  //behind a wall
+  LevelMap walled(12, 3);
+  walled[1][1] = PlayerTile;
+  walled[1][8] = 'I';
+  for(int y=0; y<3; ++y) {
+    walled[y][4] = WallTile;
+  }
+  GameBoard hidden(nullptr, Actor(0, 0, "Player", PlayerTile, true), walled, 4);
+  Observation seen = Agent(hidden).observe();
+  assert(seen.actors.empty() && seen.tiles[1][8] == UnseenGlyph && seen.tiles[1][4] != UnseenGlyph
+	 && seen.tiles[1][1] != UnseenGlyph && "Hidden cells or monsters observed");
+  walled[1][4] = 0;
+  GameBoard clear(nullptr, Actor(0, 0, "Player", PlayerTile, true), walled, 4);
+  seen = Agent(clear).observe();
+  assert(seen.actors.size() == 1 && seen.tiles[1][8] != UnseenGlyph && "Visible monster not observed");
+
+  std::mt19937 generator(1);
+  std::uniform_int_distribution<int> step(-1, 1);
+  for(int i=0; i<300 && !agent.isOver(); ++i) {
+    agent.act(Action{ActionType::MOVE, step(generator), step(generator)});
+    assert(board.hash() == board.computeHash() && "Incremental hash out of sync");
+  }
+  int turn = board.turn();
+  assert(turn >= 2 && board.rewind(2) && "Couldn't rewind");
+  assert(board.turn() == turn - 2 && board.hash() == board.turnHashes().back()
+	 && board.hash() == board.computeHash() && "Rewind didn't restore board");
+
+  //Rewound turns replay the same way when the same actions are taken again,
+  //fights, scent and what the monsters knew included
+  Actor tough(0, 0, "Player", PlayerTile, true);
+  tough.addHealth(20000);
+  GameBoard replayed(nullptr, tough, "test-map1.csv", 3);
+  Agent replayer(replayed);
+  std::vector<std::pair<int, Action>> played; //Turn each action was taken on
+  //Long enough for fights, short enough that they're still going on
+  for(int i=0; i<120; ++i) {
+    Action move{ActionType::MOVE, step(generator), step(generator)};
+    played.push_back({replayed.turn(), move});
+    replayer.act(move);
+  }
+  turn = replayed.turn();
+  const std::vector<std::uint64_t> hashes = replayed.turnHashes();
+  const std::uint64_t end = replayed.hash();
+  assert(turn >= 20 && replayed.rewind(20) && replayed.turn() == turn - 20 && "Couldn't rewind");
+  for(const std::pair<int, Action> &each : played) {
+    if(each.first >= turn - 20) {
+      replayer.act(each.second);
+    }
+  }
+  assert(replayed.turnHashes() == hashes && replayed.hash() == end
+	 && "Rewound turns replayed differently");
+  std::cout << "All agent tests passed\n";
+}
+
+static void testBatch()
+{
+  //Tasks submitted from inside tasks still all run before wait() returns
+  {
+    ThreadPool pool(3);
+    std::atomic<int> count(0);
+    for(int i=0; i<10; ++i) {
+      pool.submit([&pool, &count] {
+	for(int j=0; j<10; ++j) {
+	  pool.submit([&count] { ++count; });
+	}
+      });
+    }
+    pool.wait();
+    assert(count == 100 && "Thread pool lost tasks");
+  }
+  //Same seeds, same games, regardless of which thread plays them
+  {
+    BatchOptions options;
+    options.games = 12;
+    options.mapPath = "test-map1.csv";
+    options.seed = 99;
+    options.threads = 3;
+    BatchReport a = runBatch(options);
+    BatchReport b = runBatch(options);
+    assert(a.wins + a.deaths + a.timeouts == options.games && "Batch lost games");
+    assert(a.totalTurns == b.totalTurns && a.deaths == b.deaths && a.totalKills == b.totalKills
+	   && "Seeded batches played out differently");
+  }
+  std::cout << "All batch tests passed\n";
+}
+
+static void testScenario()
+{
+  //Generated worlds have what was asked for, and any size loads
+  {
+    ScenarioOptions options = scenarioOfSize(400, 5);
+    options.width = 80;
+    options.height = 50;
+    std::mt19937 generator(options.seed);
+    LevelMap map = generateMap(options, generator);
+    int monsters = 0;
+    int items = 0;
+    for(int row=0; row<map.height(); ++row) {
+      for(int col=0; col<map.width(); ++col) {
+	if(map[row][col] == ItemTile) ++items;
+	else if(map[row][col] != 0 && map[row][col] != WallTile && map[row][col] != PlayerTile) ++monsters;
+      }
+    }
+    assert(monsters == 200 && items == 200 && "Generated wrong number of monsters/items");
+    GameBoard board(nullptr, Actor(0, 0, "Player", PlayerTile, true), map, 5);
+    assert(board.actors().size() == 201 && "Generated monsters not all loaded");
+    assert(board.player().getX() == 40 && board.player().getY() == 25
+	   && "Player not placed in middle of generated map");
+    assert(board.hash() == board.computeHash() && "Generated board hash wrong");
+    for(const Actor &actor : board.actors()) {
+      assert(board.sameRegion(actor, board.player()) && "Generated monster walled off");
+    }
+  }
+  //Scenarios play every turn unless out of time
+  {
+    ScenarioOptions options = scenarioOfSize(200, 6);
+    options.turns = 4;
+    ScenarioReport report = runScenario(options);
+    assert(report.turnsPlayed == 4 && !report.timedOut && "Scenario didn't play every turn");
+    assert(report.p50Ms <= report.p99Ms && report.turnsPerSecond > 0 && "Bad turn timings");
+    options.maxSeconds = 0;
+    report = runScenario(options);
+    assert(report.timedOut && report.turnsPlayed < 4 && "Scenario ignored its time limit");
+  }
+  std::cout << "All scenario tests passed\n";
+}
+
+static void testTrace()
+{
+  clearTrace();
+  //Scopes on every thread are recorded, nested scopes inside their parents
+  {
+    TraceScope outer("outer");
+    {
+      TraceScope inner("inner");
+    }
+    ThreadPool pool(2);
+    for(int i=0; i<4; ++i) {
+      pool.submit([] { TraceScope task("task"); });
+    }
+    pool.wait();
+  }
+  assert(traceEventCount() == 6 && "Trace lost events");
+  std::ostringstream json;
+  writeChromeTrace(json);
+  const std::string trace = json.str();
+  assert(trace.find("\"traceEvents\"") != std::string::npos
+	 && trace.find("\"name\":\"inner\",\"ph\":\"X\"") != std::string::npos
+	 && trace.find("\"name\":\"task\"") != std::string::npos
+	 && "Trace not in Chrome trace event format");
+  clearTrace();
+  assert(traceEventCount() == 0 && "Trace not cleared");
+  std::cout << "All trace tests passed\n";
+}
+
+static void testPerf()
+{
+  //Rolling averages only cover the latest samples
+  {
+    RollingAverage average;
+    assert(average.average() == 0 && "Empty average not 0");
+    for(int i=0; i<PerfWindow; ++i) {
+      average.add(1);
+    }
+    for(int i=0; i<PerfWindow/2; ++i) {
+      average.add(3);
+    }
+    assert(average.average() == 2 && "Rolling average kept old samples");
+  }
+  {
+    std::uint64_t before = allocationCount();
+    std::unique_ptr<int> allocated(new int(1));
+    assert((allocationCount() > before || !CountingAllocations) && "Allocation not counted");
+    assert(currentMemoryKb() != 0 && "No memory use read");
+  }
+  //A frame's counters come from the board and screen
+  {
+    Display screen(120, 50);
+    GameBoard board(&screen, Actor(0, 0, "Player", PlayerTile, true), "test-map1.csv", 3);
+    board.endTurn(board.player());
+    for(int i=0; i<5; ++i) {
+      board.updateActors();
+    }
+    board.redraw();
+    screen.present();
+    const PerfOverlay &perf = screen.perf();
+    assert(perf.actorsPerTick() == board.actors().size() && "Actor updates not counted");
+    assert(perf.cellsPerPresent() > 0 && perf.frameMs() >= 0 && "Frame not sampled");
+  }
+  std::cout << "All perf tests passed\n";
+}
+
+static void testTemplates()
+{
+  //Shipped templates load cleanly, including a last section with no blank line after it
+  {
+    std::vector<TemplateError> errors;
+    std::map<char,Actor> monsters = loadMonsterTemplates("src/monsters.ini", &errors);
+    std::map<char,Item> items = loadItemTemplates("src/items.ini", &errors);
+    assert(errors.empty() && "Shipped templates have errors");
+    assert(monsters.size() == 5 && monsters.at('P').isElite() && monsters.at('I').getName() == "Red Imp"
+	   && "Monster templates loaded wrong");
+    assert(items.count('i') == 1 && items.at('i').getName() == "Dagger" && "Last item template dropped");
+  }
+  //Bad lines are reported with their line numbers and skipped
+  {
+    const char *path = "test-templates.ini";
+    {
+      std::ofstream file(path, std::ios::binary);
+      file << "#comment\r\n"
+	   << "char=x\r\n"
+	   << "name=Good\r\n"
+	   << "strength=7\r\n"
+	   << "speed=3\r\n"
+	   << "health=lots\r\n"
+	   << "no equals sign\r\n"
+	   << "\r\n"
+	   << "\r\n"
+	   << "name=No Char\n"
+	   << "\n"
+	   << "char=y\n"
+	   << "cunning=-40000\n"
+	   << "agility=-5";
+    }
+    std::vector<TemplateError> errors;
+    std::map<char,Actor> monsters = loadMonsterTemplates(path, &errors);
+    std::remove(path);
+    assert(monsters.size() == 2 && monsters.at('x').getName() == "Good"
+	   && monsters.at('x').m_strength == 7 && monsters.at('y').m_agility == -5
+	   && "Good lines around bad ones not loaded");
+    assert(errors.size() == 5 && errors[0].line == 5 && errors[1].line == 6 && errors[2].line == 7
+	   && errors[3].line == 10 && errors[4].line == 13 && "Errors not reported at right lines");
+    errors.clear();
+    loadItemTemplates("no-such-file.ini", &errors);
+    assert(errors.size() == 1 && errors[0].line == 0 && "Missing file not reported");
+  }
+  std::cout << "All template tests passed\n";
+}
+
+static void testBundle()
+{
+  //Works on copies of the INI files in a temp directory, leaving the game's
+  //own bundle alone
+  char made[] = "/tmp/rpg-bundle-XXXXXX";
+  assert(mkdtemp(made) && "Couldn't make temp directory");
+  const std::string dir = std::string(made) + "/";
+  assert(mkdir((dir + "src").c_str(), 0700) == 0 && "Couldn't make temp src directory");
+  for(const char *file : {"src/monsters.ini", "src/items.ini"}) {
+    std::ifstream source(file);
+    std::ofstream(dir + file) << source.rdbuf();
+  }
+
+  //Bundled templates match the INI files they came from
+  std::vector<std::string> errors;
+  assert(writeTemplateBundle(dir, errors) && errors.empty() && "Couldn't write bundle");
+  TemplateSet bundled;
+  assert(readTemplateBundle(dir, bundled) && bundled.fromBundle && "Fresh bundle not read");
+  TemplateSet parsed = loadTemplateSetFromIni(dir);
+  assert(bundled.monsters.size() == parsed.monsters.size()
+	 && bundled.items.size() == parsed.items.size() && "Bundle lost templates");
+  for(const auto &entry : parsed.monsters) {
+    const Actor &a = entry.second;
+    const Actor &b = bundled.monsters.at(entry.first);
+    assert(a.getCh() == b.getCh() && a.getName() == b.getName() && a.getHealth() == b.getHealth()
+	   && a.getEnergy() == b.getEnergy() && a.isElite() == b.isElite()
+	   && a.m_strength == b.m_strength && a.m_agility == b.m_agility
+	   && a.m_meleeSkill == b.m_meleeSkill && a.m_maxCarryWeight == b.m_maxCarryWeight
+	   && "Bundled monster differs from INI");
+  }
+  for(const auto &entry : parsed.items) {
+    const Item &a = entry.second;
+    const Item &b = bundled.items.at(entry.first);
+    assert(a.getName() == b.getName() && a.getAttack() == b.getAttack() && a.getArmor() == b.getArmor()
+	   && a.getWeight() == b.getWeight() && a.isMelee() == b.isMelee() && "Bundled item differs from INI");
+  }
+  //A damaged (or stale) bundle is ignored in favor of the INI files
+  {
+    std::ofstream bundle(bundlePath(dir), std::ios::binary | std::ios::trunc);
+    bundle << "RPGT";
+  }
+  TemplateSet fallback = loadTemplateSet(dir);
+  assert(!fallback.fromBundle && fallback.monsters.size() == parsed.monsters.size()
+	 && "Bad bundle not replaced by INI templates");
+  for(const std::string &path : {bundlePath(dir), dir + "src/monsters.ini", dir + "src/items.ini",
+				 dir + "src", dir}) {
+    std::remove(path.c_str());
+  }
+  std::cout << "All bundle tests passed\n";
+}
+
+static void testHotReload()
+{
+  std::ifstream monsterSource("src/monsters.ini");
+  std::stringstream monsters;
+  monsters << monsterSource.rdbuf();
+  std::ifstream itemSource("src/items.ini");
+  std::ofstream("test-items.ini") << itemSource.rdbuf();
+  std::ofstream("test-monsters.ini") << monsters.str();
+  //Tough enough to outlast the waiting, so every reload gets a turn to land in
+  Actor tough(0, 0, "Player", PlayerTile, true);
+  tough.addHealth(20000);
+  GameBoard board(nullptr, tough, "test-map1.csv", 5);
+  board.watchTemplates("test-monsters.ini", "test-items.ini");
+  int oldStrength = board.tiles().monster('I')->m_strength;
+  //Saving the file reloads it in the background; swapped in on a later turn
+  std::string edited = monsters.str();
+  std::string::size_type strength = edited.find("strength=2");
+  assert(strength != std::string::npos && "Imp template changed; update test");
+  edited.replace(strength, 10, "strength=9");
+  std::ofstream("test-monsters.ini") << edited;
+  Agent agent(board);
+  for(int i = 0; i < 60 && board.tiles().monster('I')->m_strength != 9; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    agent.act(Action{ActionType::WAIT, 0, 0});
+  }
+  assert(oldStrength == 2 && board.tiles().monster('I')->m_strength == 9
+	 && "Edited template not reloaded");
+  bool updated = false;
+  for(const Actor &actor : board.actors()) {
+    if(actor.getCh() == 'I') {
+      updated = actor.m_strength == 9;
+    }
+  }
+  assert(updated && "Live monster not given reloaded stats");
+  //A reload with errors keeps the old templates; waits until the board has
+  //turned the bad file down, so it's known to have been read
+  board.takeMessages();
+  std::ofstream("test-monsters.ini") << "char=I\nstrength=lots\n";
+  bool rejected = false;
+  for(int i = 0; i < 60 && !rejected; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    agent.act(Action{ActionType::WAIT, 0, 0});
+    for(const std::string &message : board.takeMessages()) {
+      rejected = rejected || message == "Template reload failed; keeping the old templates";
+    }
+  }
+  assert(rejected && "Bad reload not reported");
+  assert(board.tiles().monster('I')->m_strength == 9 && "Bad reload replaced templates");
+  assert(board.hash() == board.computeHash() && "Reload broke the board hash");
+  std::remove("test-monsters.ini");
+  std::remove("test-items.ini");
+  std::cout << "All hot reload tests passed\n";
+}
+
+static void testTiles()
+{
+  std::map<char,Actor> monsters;
+  monsters['I'] = Actor(0, 0, "Imp", 'I');
+  std::map<char,Item> items;
+  items['k'] = Item(0, 0, "Key");
+  TileTable tiles;
+  assert(tiles.isEmpty(0) && tiles['I'].kind == TileKind::WALL && tiles[ItemTile].kind == TileKind::ITEM
+	 && !tiles.item(ItemTile) && "Built-in tiles wrong");
+  tiles.build(monsters, items);
+  assert(tiles['k'].kind == TileKind::ITEM && tiles.item('k')->getName() == "Key"
+	 && "Item template not in table");
+  assert(tiles['I'].kind == TileKind::MONSTER && tiles.monster('I')->getName() == "Imp"
+	 && !tiles.monster('k') && !tiles.item('I') && "Monster template not in table");
+  assert(tiles[WallTile].kind == TileKind::WALL && tiles[PlayerTile].kind == TileKind::PLAYER
+	 && tiles['%'].kind == TileKind::WALL && "Non-template tiles wrong");
+  assert(tiles[0].glyph == EmptySpace && tiles['I'].glyph == 'I' && "Tile glyphs wrong");
+  //Templates can't take over the built-in tiles
+  monsters[WallTile] = Actor(0, 0, "Wall Monster", WallTile);
+  tiles.build(monsters, items);
+  assert(tiles[WallTile].kind == TileKind::WALL && "Template redefined a wall");
+  std::cout << "All tile tests passed\n";
+}
+
+static void testLayers()
+{
+  LevelMap tiles(5, 3);
+  tiles[1][1] = PlayerTile;
+  tiles[1][2] = ItemTile;
+  tiles[1][3] = WallTile;
+  GameBoard board(nullptr, Actor(0, 0, "Player", PlayerTile, true), tiles, 1);
+  const LayeredMap &map = board.map();
+  assert(map.actors()[1][1] == PlayerTile && map.items()[1][2] == ItemTile
+	 && map.terrain()[1][3] == WallTile && map.terrain()[1][1] == 0 && "Map not split into layers");
+  assert(!board.isOpen(1, 1) && board.isOpen(2, 1) && !board.isOpen(3, 1) && "Wrong open cells");
+  //Stepping onto an Item moves there and picks it up
+  int carried = board.player().getInventorySize();
+  assert(board.translateActor(board.player(), 1, 0) && board.player().getX() == 2
+	 && "Player didn't step onto item");
+  assert(board.player().getInventorySize() == carried + 1 && map.items()[1][2] == 0
+	 && map.actors()[1][2] == PlayerTile && map.actors()[1][1] == 0 && "Item not picked up");
+  assert(map.top(2, 1) == PlayerTile && map.top(3, 1) == WallTile && map.top(0, 0) == 0
+	 && "Top of layers wrong");
+  assert(!board.translateActor(board.player(), 1, 0) && "Walked into a wall");
+  assert(board.hash() == board.computeHash() && "Layers broke the board hash");
+  //Undoing the turn restores every layer
+  assert(board.rewind(0) && map.items()[1][2] == ItemTile && map.actors()[1][1] == PlayerTile
+	 && map.actors()[1][2] == 0 && "Layers not rewound");
+  std::cout << "All layer tests passed\n";
+}
+
+static void testBitboards()
+{
+  //Random boards wider than a word, sparse and dense, checked against
+  //per-cell versions
+  std::mt19937 generator(11);
+  const int width = 70, height = 9;
+  auto inside = [&](int x, int y) { return x >= 0 && y >= 0 && x < width && y < height; };
+  for(int density=1; density<=2; ++density) {
+    Bitboard board(width, height);
+    for(int y=0; y<height; ++y) {
+      for(int x=0; x<width; ++x) {
+	board.set(x, y, static_cast<int>(generator() % 3) < density);
+      }
+    }
+    Bitboard dilated = board.dilated();
+    Bitboard crowded = board.neighboursAtLeast(3);
+    int set = 0;
+    for(int y=0; y<height; ++y) {
+      for(int x=0; x<width; ++x) {
+	int neighbours = 0;
+	bool near = board.test(x, y);
+	for(int dy=-1; dy<=1; ++dy) {
+	  for(int dx=-1; dx<=1; ++dx) {
+	    if((dx != 0 || dy != 0) && inside(x + dx, y + dy) && board.test(x + dx, y + dy)) {
+	      ++neighbours;
+	      near = true;
+	    }
+	  }
+	}
+	set += board.test(x, y);
+	assert(dilated.test(x, y) == near && "Dilation wrong");
+	assert(crowded.test(x, y) == (neighbours >= 3) && "Neighbour count wrong");
+      }
+    }
+    assert(board.count() == set && board.inverted().count() == width * height - set
+	   && "Bit counts wrong");
+    //Flood fill matches a search over the same cells
+    int startX = 0, startY = 0;
+    while(!board.test(startX, startY)) ++startX;
+    Bitboard fill = board.floodFill(startX, startY);
+    std::vector<bool> seen(width * height, false);
+    std::vector<std::pair<int,int>> frontier{{startX, startY}};
+    seen[startY * width + startX] = true;
+    int reached = 0;
+    while(!frontier.empty()) {
+      std::pair<int,int> cell = frontier.back();
+      frontier.pop_back();
+      ++reached;
+      assert(fill.test(cell.first, cell.second) && "Flood fill missed a cell");
+      for(int dy=-1; dy<=1; ++dy) {
+	for(int dx=-1; dx<=1; ++dx) {
+	  int x = cell.first + dx, y = cell.second + dy;
+	  if(inside(x, y) && !seen[y * width + x] && board.test(x, y)) {
+	    seen[y * width + x] = true;
+	    frontier.push_back({x, y});
+	  }
+	}
+      }
+    }
+    assert(fill.count() == reached && "Flood fill reached extra cells");
+  }
+  //Lines are blocked by set cells between (not at) their ends
+  Bitboard wall(10, 10);
+  wall.set(5, 5);
+  assert(wall.lineBlocked(3, 3, 7, 7) && wall.lineBlocked(5, 0, 5, 9) && "Line passed through wall");
+  assert(!wall.lineBlocked(3, 3, 5, 5) && !wall.lineBlocked(0, 9, 9, 0) && !wall.lineBlocked(2, 2, 2, 2)
+	 && "Line blocked without a wall between");
+  //The board keeps its bitboards in step with its layers
+  GameBoard game(nullptr, Actor(0, 0, "Player", PlayerTile, true), "test-map1.csv", 2);
+  Agent agent(game);
+  for(int i=0; i<5; ++i) {
+    agent.act(Action{ActionType::WAIT, 0, 0});
+  }
+  assert(game.walls() == Bitboard::fromLayer(game.map().terrain())
+	 && game.occupied() == Bitboard::fromLayer(game.map().actors()) && "Bitboards out of step");
+  assert(game.rewind(2) && game.occupied() == Bitboard::fromLayer(game.map().actors())
+	 && "Bitboards not rewound");
+  std::cout << "All bitboard tests passed\n";
+}
+
+static void testRegions()
+{
+  //A wall down the middle splits the map in two
+  Bitboard walls(9, 5);
+  for(int y=0; y<5; ++y) {
+    walls.set(4, y);
+  }
+  RegionMap regions(walls);
+  assert(regions.regionCount() == 2 && regions.regionOf(4, 2) == -1 && "Wrong regions");
+  assert(regions.sameRegion(0, 0, 3, 4) && !regions.sameRegion(0, 0, 5, 0)
+	 && regions.regionSize(regions.regionOf(0, 0)) == 20 && "Wrong region membership");
+  //Opening a gap joins them, closing it splits them again
+  walls.set(4, 2, false);
+  regions.opened(4, 2);
+  assert(regions.regionCount() == 1 && regions.sameRegion(0, 0, 8, 4)
+	 && regions.regionSize(regions.regionOf(4, 2)) == 41 && "Opened wall didn't join regions");
+  walls.set(4, 2);
+  regions.relabel(walls);
+  assert(regions.regionCount() == 2 && !regions.sameRegion(0, 0, 8, 4) && "Regions not split");
+  //A diagonal gap is enough, like a diagonal step
+  Bitboard diagonal(3, 3);
+  diagonal.set(1, 0);
+  diagonal.set(0, 1);
+  assert(RegionMap(diagonal).sameRegion(0, 0, 2, 2) && "Diagonal neighbours not joined");
+
+  //Monsters walled off from the player are reported, and don't try to move
+  LevelMap tiles(9, 5);
+  for(int y=0; y<5; ++y) {
+    tiles[y][4] = WallTile;
+  }
+  tiles[2][1] = PlayerTile;
+  tiles[2][7] = 'I';
+  GameBoard board(nullptr, Actor(0, 0, "Player", PlayerTile, true), tiles, 4);
+  bool warned = false;
+  for(const std::string &message : board.takeMessages()) {
+    warned |= message.find("can't reach") != std::string::npos;
+  }
+  assert(warned && !board.sameRegion(board.actorAt(1), board.player()) && "Sealed-off monster not reported");
+  Agent agent(board);
+  agent.act(Action{ActionType::WAIT, 0, 0});
+  assert(board.actorAt(1).getX() == 7 && board.actorAt(1).getY() == 2
+	 && "Sealed-off monster moved");
+  std::cout << "All region tests passed\n";
+}
+
+static void testDormancy()
+{
+  //A monster far down the corridor sleeps and isn't updated
+  LevelMap tiles(80, 3);
+  tiles[1][1] = PlayerTile;
+  tiles[1][35] = 'I';
+  GameBoard board(nullptr, Actor(0, 0, "Player", PlayerTile, true), tiles, 4);
+  Agent agent(board);
+  assert(!board.isAwake(1) && board.isAwake(0) && board.awakeActors().size() == 1
+	 && "Far monster not dormant");
+  agent.act(Action{ActionType::WAIT, 0, 0});
+  assert(board.actorAt(1).getX() == 35 && "Dormant monster moved");
+  //A scheduled wake-up fires at the start of that turn, and the monster
+  //stays awake while within SleepRadius (though it can't see or smell the player)
+  board.scheduleWake(35, 1, 2, 2);
+  agent.act(Action{ActionType::WAIT, 0, 0});
+  assert(!board.isAwake(1) && "Woken too early");
+  agent.act(Action{ActionType::WAIT, 0, 0});
+  assert(board.isAwake(1) && "Scheduled wake-up didn't fire");
+  agent.act(Action{ActionType::WAIT, 0, 0});
+  agent.act(Action{ActionType::WAIT, 0, 0});
+  assert(board.isAwake(1) && "Woken monster went back to sleep");
+  assert(board.hash() == board.computeHash() && "Hash out of sync");
+  //Rewinding keeps who was awake, rather than deciding it afresh
+  assert(board.rewind(1) && board.isAwake(1) && "Rewind put woken monster to sleep");
+
+  //Monsters spawned or walking into the activity radius wake up
+  assert(board.spawnMonster('I', 10, 1) && board.isAwake(2) && "Nearby spawn dormant");
+  assert(board.spawnMonster('I', 60, 1) && !board.isAwake(3) && "Far spawn awake");
+  board.wakeNear(60, 1, NoiseRadius);
+  assert(board.isAwake(3) && board.awakeActors().size() == 4 && "Noise didn't wake monster");
+  std::cout << "All dormancy tests passed\n";
+}
+
+static void testTravel()
+{
+  //The shortest path goes around the wall, diagonals included
+  Bitboard blocked(5, 5);
+  for(int y=0; y<4; ++y) {
+    blocked.set(2, y);
+  }
+  std::vector<PathStep> path = findPath(blocked, 0, 0, [](int x, int y) { return x == 4 && y == 0; });
+  assert(path.size() == 8 && path.back().x == 4 && path.back().y == 0
+	 && path[3].x == 2 && path[3].y == 4 && "Wrong path");
+  blocked.set(2, 4);
+  assert(findPath(blocked, 0, 0, [](int x, int y) { return x == 4 && y == 0; }).empty()
+	 && "Path through a wall");
+
+  //Travelling walks there TurnEnergy steps a turn, seeing the way as it goes
+  LevelMap tiles(60, 12);
+  for(int y=0; y<9; ++y) {
+    tiles[y][20] = WallTile;
+  }
+  tiles[1][1] = PlayerTile;
+  GameBoard board(nullptr, Actor(0, 0, "Player", PlayerTile, true), tiles, 4);
+  assert(board.explored().test(1, 1) && !board.explored().test(40, 1) && "Wrong start of exploration");
+  assert(board.travelTo(board.player(), 40, 1) && board.player().getX() == 40
+	 && board.player().getY() == 1 && "Travel didn't arrive");
+  assert(board.turn() >= 38 / TurnEnergy && board.explored().test(40, 1) && board.hash() == board.computeHash()
+	 && "Travel wasn't played out turn by turn");
+  assert(!board.travelTo(board.player(), 20, 0) && "Travelled into a wall");
+
+  //Exploring sees everything reachable, and travel stops when a monster appears
+  assert(board.autoExplore() && "Didn't explore");
+  Bitboard unseen = board.walls().inverted();
+  unseen.andNot(board.explored());
+  assert(!unseen.any() && "Part of the map not explored");
+  assert(!board.autoExplore() && "Explored with nothing left");
+  LevelMap corridor(60, 3);
+  corridor[1][1] = PlayerTile;
+  corridor[1][35] = 'I';
+  GameBoard hunted(nullptr, Actor(0, 0, "Player", PlayerTile, true), corridor, 4);
+  hunted.takeMessages();
+  assert(hunted.travelTo(hunted.player(), 55, 1) && hunted.player().getX() < 35 && "Travel not interrupted");
+  bool announced = false;
+  for(const std::string &message : hunted.takeMessages()) {
+    announced |= message.find("comes into view") != std::string::npos;
+  }
+  assert(announced && !hunted.travelTo(hunted.player(), 55, 1) && "Monster in view not reported");
+  std::cout << "All travel tests passed\n";
+}
+
+static void testLineOfFire()
+{
+  //The table holds the same rays as tracing them, and longer rays are walked
+  auto stepsOf = [](int dx, int dy) {
+    std::vector<std::pair<int, int>> steps;
+    for(const RayStep &step : Ray(dx, dy)) {
+      steps.emplace_back(step.dx, step.dy);
+    }
+    return steps;
+  };
+  for(int dy=-RayTableRadius-2; dy<=RayTableRadius+2; ++dy) {
+    for(int dx=-RayTableRadius-2; dx<=RayTableRadius+2; ++dx) {
+      std::vector<std::pair<int, int>> traced;
+      for(const RayStep &step : traceRay(dx, dy)) {
+	traced.emplace_back(step.dx, step.dy);
+      }
+      assert(stepsOf(dx, dy) == traced && "Ray doesn't match traced ray");
+    }
+  }
+  std::vector<std::pair<int, int>> far = stepsOf(40, -7);
+  assert(far.size() == 40 && far.back() == std::make_pair(40, -7) && "Wrong long ray");
+  //Rays too long for a RayStep have no steps, rather than wrapping around
+  assert(stepsOf(MaxRayLength, 0).size() == static_cast<std::size_t>(MaxRayLength)
+	 && stepsOf(MaxRayLength + 1, 0).empty() && stepsOf(0, -1000000000).empty()
+	 && "Overlong ray not rejected");
+
+  LevelMap tiles(20, 5);
+  tiles[2][1] = PlayerTile;
+  tiles[2][8] = 'I';
+  tiles[2][12] = 'I';
+  tiles[1][2] = WallTile;
+  tiles[0][3] = 'I';
+  tiles[3][2] = WallTile;
+  tiles[4][4] = WallTile;
+  Item bow(0, 0, "Bow", 2);
+  bow.setRanged(true);
+  Actor archer(0, 0, "Player", PlayerTile, true);
+  archer.addItem(bow);
+  archer.equipItem(0, RANGE_WEAPON);
+  GameBoard board(nullptr, archer, tiles, 4);
+  LineOfFire line = board.traceFire(1, 4, 8, 4);
+  assert(line.hit == LineHit::WALL && line.x == 4 && line.y == 4 && "Line went through a wall");
+  line = board.traceFire(1, 2, 12, 2);
+  assert(line.hit == LineHit::ACTOR && line.x == 8 && line.y == 2 && "Line went through an actor");
+  assert(board.traceFire(1, 2, 5, 2).hit == LineHit::NOTHING && "Clear line stopped");
+  line = board.traceFire(1, 2, 1, -50);
+  assert(line.hit == LineHit::OFF_MAP && line.x == 1 && line.y == 0 && "Line left the map");
+  line = board.traceFire(1, 2, 1, -1000000000);
+  assert(line.hit == LineHit::OFF_MAP && line.x == 1 && line.y == 2 && "Overlong line left the map");
+
+  //Shots hit the first actor in the way, and walls stop shots and teleports
+  int health = board.actors()[3].getHealth();
+  assert(board.rangeAttack(board.player(), 12, 2) && board.actors()[3].getHealth() == health
+	 && "Shot passed through an actor");
+  assert(!board.rangeAttack(board.player(), 3, 0) && "Shot through a wall");
+  assert(!board.rangeAttack(board.player(), 1, -50)
+	 && !board.rangeAttack(board.player(), 1000000000, 0) && "Shot off the map");
+  assert(!board.moveActor(board.player(), 3, 4) && board.player().getX() == 1
+	 && "Teleported through a wall");
+  assert(board.moveActor(board.player(), 4, 2) && board.hash() == board.computeHash()
+	 && "Clear teleport failed");
+  std::cout << "All line of fire tests passed\n";
+}
+
+static void testTargeting()
+{
+  LevelMap tiles(80, 6);
+  tiles[1][1] = PlayerTile;
+  tiles[1][5] = 'I';
+  tiles[3][3] = 'I';
+  tiles[1][70] = 'I';
+  GameBoard board(nullptr, Actor(0, 0, "Player", PlayerTile, true), tiles, 4);
+  //Nearest first, limited to the radius/count asked for, across words
+  std::vector<int> hostiles = board.nearestHostiles(board.player(), 100, 5, false);
+  assert(hostiles.size() == 3 && board.actors()[hostiles[0]].getY() == 3
+	 && board.actors()[hostiles[1]].getX() == 5 && board.actors()[hostiles[2]].getX() == 70
+	 && "Wrong nearest hostiles");
+  assert(board.nearestHostiles(board.player(), 4, 5, false).size() == 2
+	 && board.nearestHostiles(board.player(), 100, 1, false).size() == 1 && "Radius/count ignored");
+  std::vector<int> all = board.nearestActors(1, 1, 100, 10, [](const Actor&) { return true; });
+  assert(all.size() == 4 && all[0] == 0 && "Wrong nearest actors");
+  assert(board.targetFor(board.actors()[hostiles[0]]) == &board.player() && "Monster not after player");
+
+  //Monsters hidden behind a wall aren't visible targets
+  LevelMap walled = tiles;
+  walled[2][2] = WallTile;
+  GameBoard hidden(nullptr, Actor(0, 0, "Player", PlayerTile, true), walled, 4);
+  hostiles = hidden.nearestHostiles(hidden.player(), SightRadius, MaxTargets, true);
+  assert(hostiles.size() == 1 && hidden.actors()[hostiles[0]].getX() == 5
+	 && "Hidden monster targeted");
+
+  //The cursor jumps to the nearest visible hostile, then cycles through them
+  Display screen(120, 50);
+  GameBoard shown(&screen, Actor(0, 0, "Player", PlayerTile, true), tiles, 4);
+  shown.cycleTarget();
+  assert(screen.hasCursor() && screen.getCursorX() == 3 && screen.getCursorY() == 3
+	 && "Cursor not on nearest target");
+  shown.cycleTarget();
+  assert(screen.getCursorX() == 5 && screen.getCursorY() == 1 && "Cursor didn't cycle");
+  shown.cycleTarget();
+  assert(screen.getCursorX() == 3 && "Cursor didn't wrap around");
+
+  //The index of who's where stays right as Actors move and die
+  Agent agent(board);
+  for(int turn=0; turn<30 && !agent.isOver(); ++turn) {
+    agent.act(Action{ActionType::WAIT, 0, 0});
+  }
+  for(std::size_t i=0; i<board.actors().size(); ++i) {
+    const Actor &actor = board.actors()[i];
+    assert((!actor.isAlive() || board.actorIndexAt(actor.getX(), actor.getY()) == static_cast<int>(i))
+	   && "Actor index out of step");
+  }
+  int width = board.map().width(), height = board.map().height();
+  assert(board.actorIndexAt(width, 0) == -1 && board.actorIndexAt(-1, 1) == -1
+	 && board.actorIndexAt(0, height) == -1 && "Off-map cell has an actor");
+  std::cout << "All targeting tests passed\n";
+}
+
+static void testScent()
+{
+  //Scent spreads along a corridor, fading with distance, but not into walls
+  Bitboard walls(20, 3);
+  for(int x=0; x<20; ++x) {
+    walls.set(x, 0);
+    walls.set(x, 2);
+  }
+  ScentMap scent(walls);
+  for(int turn=0; turn<10; ++turn) {
+    scent.spread();
+    scent.emit(0, 1);
+  }
+  assert(scent.at(0, 1) == 1.0f && scent.at(4, 1) > scent.at(5, 1) && scent.at(5, 1) > 0
+	 && scent.at(4, 0) == 0 && scent.at(19, 1) == 0 && "Scent didn't spread along the corridor");
+  int dx = 0, dy = 0;
+  assert(scent.strongestNeighbour(5, 1, dx, dy) && dx == -1 && dy == 0 && "Wrong scent gradient");
+  const float trail = scent.at(5, 1);
+  ScentSnapshot saved = scent.save();
+  //Left alone, it fades away entirely
+  for(int turn=0; turn<2000; ++turn) {
+    scent.spread();
+  }
+  assert(scent.at(0, 1) == 0 && !scent.strongestNeighbour(1, 1, dx, dy) && "Scent didn't fade");
+  scent.restore(saved);
+  assert(scent.at(0, 1) == 1.0f && scent.at(5, 1) == trail && scent.at(19, 1) == 0
+	 && "Saved scent not restored");
+  scent.restore(ScentSnapshot());
+  assert(scent.at(0, 1) == 0 && "Scent left after restoring none");
+
+  //A monster around the corner can't see the player, but follows their scent
+  LevelMap tiles(20, 20);
+  for(int y=0; y<20; ++y) {
+    for(int x=0; x<20; ++x) {
+      bool corridor = (y == 1 && x >= 1 && x <= 15) || (x == 15 && y >= 1 && y <= 15);
+      tiles[y][x] = corridor ? 0 : WallTile;
+    }
+  }
+  tiles[1][9] = PlayerTile;
+  tiles[6][15] = 'I';
+  GameBoard board(nullptr, Actor(0, 0, "Player", PlayerTile, true), tiles, 4);
+  assert(board.targetFor(board.actorAt(1)) == nullptr && "Monster sees around corners");
+  Agent agent(board);
+  agent.act(Action{ActionType::WAIT, 0, 0});
+  assert(board.actorAt(1).getY() == 6 && "Monster moved without scent");
+  //Rewinding a turn brings back the scent it started with
+  std::vector<float> corridor;
+  for(int x=0; x<20; ++x) {
+    corridor.push_back(board.scent().at(x, 1));
+  }
+  agent.act(Action{ActionType::WAIT, 0, 0});
+  assert(board.rewind(1) && "Couldn't rewind");
+  for(int x=0; x<20; ++x) {
+    assert(board.scent().at(x, 1) == corridor[x] && "Scent not rewound");
+  }
+  for(int turn=0; turn<30 && board.actors().size() > 1 && board.actorAt(1).getY() > 1; ++turn) {
+    agent.act(Action{ActionType::WAIT, 0, 0});
+  }
+  assert((board.actors().size() == 1 || board.actorAt(1).getY() == 1) && "Monster didn't follow scent");
+  std::cout << "All scent tests passed\n";
+}
+
+/* Builds a 120x60 crowd of Imps (one on every spacing-th diagonal, among
+   columns of wall) around a tough player, and waits out the given turns on
+   two copies: one working with 4 threads, one serially. Both must play
+   out the same; check is then handed the two boards to compare further*/
+template<typename Check>
+static void playCrowd(int spacing, int turns, Check check)
+{
+  LevelMap crowd(120, 60);
+  for(int y=0; y<60; ++y) {
+    for(int x=0; x<120; ++x) {
+      if(x % 7 == 3 && y % 5 != 0) crowd[y][x] = WallTile;
+      else if((x + y) % spacing == 0) crowd[y][x] = 'I';
+    }
+  }
+  crowd[30][60] = PlayerTile;
+  Actor tough(0, 0, "Player", PlayerTile, true);
+  tough.addHealth(1000);
+  GameBoard parallel(nullptr, tough, crowd, 4);
+  GameBoard serial(nullptr, tough, crowd, 4);
+  parallel.setSearchThreads(4);
+  serial.setSearchThreads(0);
+  Agent parallelAgent(parallel);
+  Agent serialAgent(serial);
+  for(int turn=0; turn<turns; ++turn) {
+    parallelAgent.act(Action{ActionType::WAIT, 0, 0});
+    serialAgent.act(Action{ActionType::WAIT, 0, 0});
+  }
+  assert(parallel.actors().size() == serial.actors().size()
+	 && parallel.turnHashes() == serial.turnHashes() && "Parallel crowd played differently");
+  check(parallel, serial);
+}
+
+static void testPerception()
+{
+  //A monster in plain sight notices the player, and remembers where
+  LevelMap tiles(20, 20);
+  for(int y=0; y<20; ++y) {
+    for(int x=0; x<20; ++x) {
+      bool corridor = (y == 1 && x >= 1 && x <= 15) || (x == 15 && y >= 1 && y <= 15);
+      tiles[y][x] = corridor ? 0 : WallTile;
+    }
+  }
+  tiles[3][15] = PlayerTile;
+  tiles[9][15] = 'I';
+  GameBoard board(nullptr, Actor(0, 0, "Player", PlayerTile, true), tiles, 4);
+  Perception seen = board.perceptionOf(board.actorAt(1));
+  assert(seen.seesPlayer && seen.lastX == 15 && seen.lastY == 3 && seen.lastSeen == 0
+	 && seen.target == board.nearestHostiles(board.actorAt(1), SightRadius, 1, true)[0]
+	 && board.targetFor(board.actorAt(1)) == &board.player() && "Monster didn't notice player");
+  //Once the player slips around the corner, it still knows where they were
+  Agent agent(board);
+  agent.act(Action{ActionType::MOVE, 0, -1});
+  agent.act(Action{ActionType::MOVE, 0, -1});
+  agent.act(Action{ActionType::MOVE, -1, 0});
+  seen = board.perceptionOf(board.actorAt(1));
+  assert(!seen.seesPlayer && seen.lastSeen == 0 && seen.lastX == 15 && seen.lastY == 3
+	 && seen.target == -1 && board.targetFor(board.actorAt(1)) == nullptr && "Monster didn't remember player");
+  //...and doesn't forget when the turn is rewound
+  assert(board.rewind(0) && board.perceptionOf(board.actorAt(1)).lastSeen == 0
+	 && "Rewind wiped monster's memory");
+
+  //An agile player can get nearer to a monster before it notices them
+  LevelMap room(20, 5);
+  room[2][1] = PlayerTile;
+  room[2][8] = 'I';
+  GameBoard clumsy(nullptr, Actor(0, 0, "Player", PlayerTile, true), room, 4);
+  assert(clumsy.perceptionOf(clumsy.actorAt(1)).seesPlayer && "Monster missed player");
+  Actor sneak(0, 0, "Player", PlayerTile, true);
+  sneak.m_agility = 20;
+  GameBoard sneaky(nullptr, sneak, room, 4);
+  assert(!sneaky.perceptionOf(sneaky.actorAt(1)).seesPlayer && "Monster noticed sneaking player");
+
+  //Working out a crowd's perception in parallel gives the same as serially
+  playCrowd(3, 1, [](GameBoard &parallel, GameBoard &serial) {
+    assert(parallel.awakeActors().size() > 2 * PerceptionChunk && "Crowd not big enough");
+    int seeing = 0, hidden = 0;
+    for(std::size_t i=1; i<parallel.actors().size(); ++i) {
+      const Perception &a = parallel.perceptionOf(parallel.actorAt(i));
+      const Perception &b = serial.perceptionOf(serial.actorAt(i));
+      assert(a.seesPlayer == b.seesPlayer && a.lastSeen == b.lastSeen && a.lastX == b.lastX
+	     && a.lastY == b.lastY && "Parallel perception differs");
+      if(parallel.isAwake(i)) {
+	++(a.seesPlayer ? seeing : hidden);
+      }
+    }
+    assert(seeing > 0 && hidden > 0 && "Walls didn't hide anyone");
+  });
+  std::cout << "All perception tests passed\n";
+}
+
+static void testPlanning()
+{
+  //Two monsters planning a step into the same cell: the one committed first
+  //(backwards from the player) gets it, and the other goes around
+  LevelMap tiles(10, 5);
+  tiles[2][5] = PlayerTile;
+  tiles[1][3] = 'I';
+  tiles[3][3] = 'I';
+  GameBoard board(nullptr, Actor(0, 0, "Player", PlayerTile, true), tiles, 4);
+  MovePlan first = board.actorAt(1).plan(board);
+  MovePlan second = board.actorAt(2).plan(board);
+  assert(!first.wait && !second.wait && first.dx == 1 && first.dy == 1 && second.dx == 1
+	 && second.dy == -1 && "Monsters didn't plan the same cell");
+  board.endTurn(board.player());
+  board.updateActors();
+  assert(board.actorAt(2).getX() == 4 && board.actorAt(2).getY() == 2
+	 && board.actorAt(1).getX() == 3 && board.actorAt(1).getY() == 2
+	 && board.actorAt(1).getHealth() == board.actorAt(2).getHealth()
+	 && board.hash() == board.computeHash() && "Conflicting plans not resolved");
+
+  //A horde plays out the same however many threads plan its moves
+  playCrowd(2, 3, [](GameBoard &parallel, GameBoard &serial) {
+    assert(parallel.awakeActors().size() > PlanChunk && "Horde not big enough");
+    assert(parallel.hash() == serial.hash() && parallel.hash() == parallel.computeHash()
+	   && "Parallel planning not reproducible");
+  });
+  std::cout << "All planning tests passed\n";
+}
+
+static void testHorde()
+{
+  //The arena is open but for its walls and a few pillars, the player in the middle
+  HordeOptions options = hordeOfSize(300, 7);
+  options.waveSize = 100;
+  options.waveTurns = 2;
+  std::mt19937 generator(options.seed);
+  LevelMap arena = generateArena(options, generator);
+  assert(arena[arena.height() / 2][arena.width() / 2] == PlayerTile && arena[0][0] == WallTile
+	 && "Arena not walled with player in middle");
+  HordeOptions tiny = hordeOfSize(-5, 7);
+  assert(tiny.maxMonsters == 1 && tiny.waveSize == 1 && tiny.width == MapWidth
+	 && tiny.height == MapHeight && "Horde size below 1 not clamped");
+  Actor tough(0, 0, "Player", PlayerTile, true);
+  tough.addHealth(1000000);
+  GameBoard board(nullptr, tough, arena, options.seed);
+  Horde horde(board, options);
+
+  //Waves arrive on schedule, out of the player's sight, and all wake up
+  assert(horde.update() == 100 && horde.update() == 0 && horde.alive() == 100 && "Wrong first wave");
+  const Actor &you = board.player();
+  for(std::size_t i=1; i<board.actors().size(); ++i) {
+    const Actor &monster = board.actors()[i];
+    int dx = monster.getX() - you.getX(), dy = monster.getY() - you.getY();
+    assert(dx * dx + dy * dy >= HordeSpawnDistance * HordeSpawnDistance && "Monster spawned too near");
+    assert(board.isAwake(i) && !monster.isElite() && "Horde monster dormant or elite");
+  }
+  auto averageDistance = [&board]() {
+    const Actor &player = board.player();
+    double total = 0;
+    for(std::size_t i=1; i<board.actors().size(); ++i) {
+      total += std::abs(board.actors()[i].getX() - player.getX())
+	+ std::abs(board.actors()[i].getY() - player.getY());
+    }
+    return total / (board.actors().size() - 1);
+  };
+  double before = averageDistance();
+  Agent agent(board);
+  agent.act(Action{ActionType::WAIT, 0, 0});
+  assert(averageDistance() < before && "Horde didn't close in");
+  agent.act(Action{ActionType::WAIT, 0, 0});
+  assert(horde.update() == 100 && horde.alive() == 200 && "Second wave didn't arrive");
+
+  //Waves stop once the horde is at full strength
+  horde.fill();
+  assert(horde.alive() == 300 && horde.spawnWave() == 0 && "Horde not kept at full strength");
+  assert(board.hash() == board.computeHash() && "Horde board hash wrong");
+  //Rewound turns replay the same, with what the horde perceives put back
+  //(from after the turn the horde was filled in)
+  for(int i=0; i<3; ++i) {
+    agent.act(Action{ActionType::WAIT, 0, 0});
+  }
+  std::uint64_t played = board.hash();
+  assert(board.rewind(2) && "Horde turns not rewound");
+  agent.act(Action{ActionType::WAIT, 0, 0});
+  agent.act(Action{ActionType::WAIT, 0, 0});
+  assert(board.hash() == played && "Rewound horde turns played out differently");
+  std::cout << "All horde tests passed\n";
+}
+
+static void testArena()
+{
+  Arena arena;
+  void *first = arena.allocate(3, 1);
+  double *aligned = static_cast<double*>(arena.allocate(sizeof(double), alignof(double)));
+  assert(reinterpret_cast<std::uintptr_t>(aligned) % alignof(double) == 0 && arena.owns(first)
+	 && arena.owns(aligned) && arena.blockCount() == 1 && "Arena allocation wrong");
+  void *big = arena.allocate(ArenaBlockSize * 2, 1);
+  assert(arena.blockCount() == 2 && arena.owns(big) && "Big allocation didn't get its own block");
+  arena.reset();
+  assert(arena.blockCount() == 1 && arena.bytesUsed() == 0 && !arena.owns(aligned)
+	 && "Arena not released in one go");
+
+  //A level's Actors, Items and inventories come from the board's Arena
+  LevelMap tiles(6, 3);
+  tiles[1][1] = PlayerTile;
+  tiles[1][2] = ItemTile;
+  tiles[1][4] = 'I';
+  GameBoard board(nullptr, Actor(0, 0, "Player", PlayerTile, true), tiles, 1);
+  assert(board.arena().owns(&board.actors()[0]) && board.arena().owns(&board.actors()[1])
+	 && board.arena().owns(board.player().getItemAt(0)) && "Level not in its Arena");
+  assert(board.translateActor(board.player(), 1, 0) && board.player().getInventorySize() == 2
+	 && board.arena().owns(board.player().getItemAt(1)) && "Picked up Item not in the Arena");
+  //Copies leave the level on the heap, so they outlive it
+  Actor copy = board.player();
+  assert(!board.arena().owns(copy.getItemAt(0)) && "Copy still in the Arena");
+  assert(board.rewind(0) && board.player().getInventorySize() == 1 && "Arena broke rewinding");
+
+  //Loading a map releases the old level, keeping the player and what they carry
+  board.loadMap(tiles);
+  assert(board.arena().blockCount() == 1 && board.actors().size() == 2
+	 && board.player().getInventorySize() == 1 && board.player().getItemAt(0)->getName() == "Knife"
+	 && board.arena().owns(board.player().getItemAt(0)) && "Level not replaced");
+  assert(copy.getInventorySize() == 2 && copy.getItemAt(0)->getName() == "Knife"
+	 && board.hash() == board.computeHash() && "Copy lost with the level");
+  std::cout << "All arena tests passed\n";
+}
+
 int main()
 {
   testRNG();
   testItems();
   testActors();
+  testHashing();
+  testHistory();
+  testLookahead();
+  testAgent();
+  testBatch();
+  testScenario();
+  testTrace();
+  testPerf();
+  testTemplates();
+  testTiles();
+  testLayers();
+  testBitboards();
+  testRegions();
+  testBundle();
+  testHotReload();
+  testDormancy();
+  testTravel();
+  testLineOfFire();
+  testTargeting();
+  testScent();
+  testPerception();
+  testPlanning();
+  testHorde();
+  testArena();
   return 0;
 }